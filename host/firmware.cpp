@@ -0,0 +1,11 @@
+/*
+  Written by sigroot (github.com/sigroot)
+
+  firmware.cpp - Builds the unmodified LEDMatrix firmware sketch against the
+  host Arduino shim.
+
+*/
+
+#include "Arduino.h"
+
+#include "../rp2040_firmware/rp2040_firmware.ino"
@@ -0,0 +1,280 @@
+/*
+  Written by sigroot (github.com/sigroot)
+
+  fwasset.cpp - Compresses images and animations into flash tables for the
+  LEDMatrix firmware.
+
+  fwasset <output.h> <name>=<frame.pgm>[,<frame.pgm>...] ...
+    Reads each 9x34 PGM frame (P2 or P5) of each named asset and writes
+    them, compressed, as const tables to <output.h>. Prints the size of
+    every asset before and after compression.
+
+  Each frame is coded against the frame before it (the first against a
+  blank frame) as tokens over its pixels in reading order:
+    0b00nnnnnn          - n+1 pixels are unchanged
+    0b01nnnnnn v        - n+1 pixels are v
+    0b1nnnnnnn v0...vn  - the next n+1 pixels are v0 to vn
+  A frame's tokens always cover exactly 306 pixels, so frames follow each
+  other with no separator. rp2040_assets.h decodes this format.
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+
+//    *** Constants ***
+
+const int width = 9;
+const int height = 34;
+const int pixels = width * height;
+
+// The longest run of each token.
+const int skipLimit = 64;
+const int repeatLimit = 64;
+const int literalLimit = 128;
+
+
+//    *** PGM ***
+
+// Reads the next header number of a PGM file, skipping comments.
+bool readNumber(FILE *file, int &value) {
+  int c = fgetc(file);
+  while (c != EOF) {
+    if (c == '#') {
+      while (c != EOF && c != '\n') c = fgetc(file);
+    } else if (c > ' ') {
+      break;
+    }
+    c = fgetc(file);
+  }
+  if (c == EOF || c < '0' || c > '9') return false;
+
+  value = 0;
+  while (c >= '0' && c <= '9') {
+    value = value * 10 + (c - '0');
+    c = fgetc(file);
+  }
+  return true;
+}
+
+// Reads a 9x34 greyscale PGM frame. Values are scaled to 0-255.
+bool readPGM(const std::string &path, std::vector<uint8_t> &frame, std::string &error) {
+  FILE *file = fopen(path.c_str(), "rb");
+  if (!file) {
+    error = "can not open " + path;
+    return false;
+  }
+
+  char magic[2];
+  int columns, rows, maxValue;
+  bool ok = fread(magic, 1, 2, file) == 2 && magic[0] == 'P' && (magic[1] == '2' || magic[1] == '5') &&
+            readNumber(file, columns) && readNumber(file, rows) && readNumber(file, maxValue);
+  if (!ok || maxValue <= 0 || maxValue > 255) {
+    error = path + " is not an 8 bit P2 or P5 PGM file";
+    fclose(file);
+    return false;
+  }
+  if (columns != width || rows != height) {
+    error = path + " is " + std::to_string(columns) + "x" + std::to_string(rows) + ", not 9x34";
+    fclose(file);
+    return false;
+  }
+
+  frame.resize(pixels);
+  for (int i = 0; i < pixels; i++) {
+    int value;
+    if (magic[1] == '2') {
+      ok = readNumber(file, value);
+    } else {
+      value = fgetc(file);
+      ok = value != EOF;
+    }
+    if (!ok) {
+      error = path + " ends early";
+      fclose(file);
+      return false;
+    }
+    frame[i] = value * 255 / maxValue;
+  }
+  fclose(file);
+  return true;
+}
+
+
+//    *** Compression ***
+
+// The number of pixels from start, up to limit, that equal the previous frame.
+int skipRun(const std::vector<uint8_t> &frame, const std::vector<uint8_t> &previous, int start, int limit) {
+  int length = 0;
+  while (start + length < pixels && length < limit && frame[start + length] == previous[start + length]) length++;
+  return length;
+}
+
+// The number of pixels from start, up to limit, that equal the first.
+int repeatRun(const std::vector<uint8_t> &frame, int start, int limit) {
+  int length = 0;
+  while (start + length < pixels && length < limit && frame[start + length] == frame[start]) length++;
+  return length;
+}
+
+// Appends the tokens of one frame coded against the previous frame.
+void compressFrame(const std::vector<uint8_t> &frame, const std::vector<uint8_t> &previous, std::vector<uint8_t> &out) {
+  int i = 0;
+  while (i < pixels) {
+    int skip = skipRun(frame, previous, i, skipLimit);
+    if (skip > 0) {
+      out.push_back(skip - 1);
+      i += skip;
+      continue;
+    }
+
+    int repeat = repeatRun(frame, i, repeatLimit);
+    if (repeat >= 3) {
+      out.push_back(0x40 | (repeat - 1));
+      out.push_back(frame[i]);
+      i += repeat;
+      continue;
+    }
+
+    // Literal values until a skip or repeat would be cheaper.
+    int start = i;
+    while (i < pixels && i - start < literalLimit) {
+      if (i > start && (skipRun(frame, previous, i, 2) == 2 || repeatRun(frame, i, 3) == 3)) break;
+      i++;
+    }
+    out.push_back(0x80 | (i - start - 1));
+    out.insert(out.end(), frame.begin() + start, frame.begin() + i);
+  }
+}
+
+// Decodes every frame again to check the compressed data.
+bool verify(const std::vector<std::vector<uint8_t>> &frames, const std::vector<uint8_t> &data) {
+  std::vector<uint8_t> frame(pixels, 0);
+  size_t at = 0;
+  for (const std::vector<uint8_t> &expected : frames) {
+    int i = 0;
+    while (i < pixels) {
+      if (at >= data.size()) return false;
+      uint8_t token = data[at++];
+      if (token < 0x40) {
+        i += token + 1;
+      } else if (token < 0x80) {
+        for (int n = 0; n <= (token & 0x3F) && i < pixels; n++) frame[i++] = data[at];
+        at++;
+      } else {
+        for (int n = 0; n <= (token & 0x7F) && i < pixels; n++) frame[i++] = data[at++];
+      }
+    }
+    if (i != pixels || frame != expected) return false;
+  }
+  return at == data.size();
+}
+
+
+//    *** Output ***
+
+struct Asset {
+  std::string name;
+  std::vector<std::vector<uint8_t>> frames;
+  std::vector<uint8_t> data;
+};
+
+void writeHeader(FILE *out, const std::vector<Asset> &assets) {
+  fprintf(out,
+          "/*\n"
+          "  Written by sigroot (github.com/sigroot)\n"
+          "\n"
+          "  rp2040_asset_data.h - Compressed images and animations of the LEDMatrix\n"
+          "  input module, kept in flash.\n"
+          "\n"
+          "  Generated by host/fwasset from rp2040_firmware/assets with\n"
+          "  `make -C host assets`. Do not edit by hand.\n"
+          "\n"
+          "*/\n"
+          "\n"
+          "//    *** Assets ***\n");
+
+  for (const Asset &asset : assets) {
+    fprintf(out, "\n// %s: %zu frames, %zu bytes uncompressed, %zu bytes compressed.\n",
+            asset.name.c_str(), asset.frames.size(), asset.frames.size() * pixels, asset.data.size());
+    fprintf(out, "const uint8_t %sAssetData[%zu] = {", asset.name.c_str(), asset.data.size());
+    for (size_t i = 0; i < asset.data.size(); i++) {
+      fprintf(out, "%s0x%02X%s", i % 12 == 0 ? "\n  " : " ", asset.data[i], i + 1 < asset.data.size() ? "," : "");
+    }
+    fprintf(out, "\n};\n");
+    fprintf(out, "const Asset %sAsset = { %sAssetData, sizeof(%sAssetData), %zu };\n",
+            asset.name.c_str(), asset.name.c_str(), asset.name.c_str(), asset.frames.size());
+  }
+
+  fprintf(out, "\n// Every asset, for reporting.\nconst Asset *const assetList[] = {");
+  for (size_t i = 0; i < assets.size(); i++) {
+    fprintf(out, "%s&%sAsset", i ? ", " : " ", assets[i].name.c_str());
+  }
+  fprintf(out, " };\nconst uint8_t assetCount = %zu;\n", assets.size());
+}
+
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: fwasset <output.h> <name>=<frame.pgm>[,<frame.pgm>...] ...\n");
+    return 2;
+  }
+
+  std::vector<Asset> assets;
+  for (int i = 2; i < argc; i++) {
+    std::string argument = argv[i];
+    size_t equals = argument.find('=');
+    if (equals == std::string::npos || equals == 0) {
+      fprintf(stderr, "fwasset: expected <name>=<frame.pgm>,... not %s\n", argv[i]);
+      return 2;
+    }
+
+    Asset asset;
+    asset.name = argument.substr(0, equals);
+    std::string paths = argument.substr(equals + 1);
+    for (size_t start = 0; start <= paths.size();) {
+      size_t comma = paths.find(',', start);
+      if (comma == std::string::npos) comma = paths.size();
+
+      std::vector<uint8_t> frame;
+      std::string error;
+      if (!readPGM(paths.substr(start, comma - start), frame, error)) {
+        fprintf(stderr, "fwasset: %s\n", error.c_str());
+        return 1;
+      }
+      asset.frames.push_back(frame);
+      start = comma + 1;
+    }
+    if (asset.frames.size() > 255) {
+      fprintf(stderr, "fwasset: %s has more than 255 frames\n", asset.name.c_str());
+      return 1;
+    }
+
+    std::vector<uint8_t> previous(pixels, 0);
+    for (const std::vector<uint8_t> &frame : asset.frames) {
+      compressFrame(frame, previous, asset.data);
+      previous = frame;
+    }
+    if (!verify(asset.frames, asset.data)) {
+      fprintf(stderr, "fwasset: %s does not decode to its frames\n", asset.name.c_str());
+      return 1;
+    }
+
+    printf("%-12s %3zu frames %6zu bytes -> %5zu bytes\n", asset.name.c_str(), asset.frames.size(),
+           asset.frames.size() * pixels, asset.data.size());
+    assets.push_back(asset);
+  }
+
+  FILE *out = fopen(argv[1], "w");
+  if (!out) {
+    fprintf(stderr, "fwasset: can not write %s\n", argv[1]);
+    return 1;
+  }
+  writeHeader(out, assets);
+  fclose(out);
+  return 0;
+}
@@ -0,0 +1,132 @@
+/*
+  Written by sigroot (github.com/sigroot)
+
+  fwbench.cpp - Measures how fast frames can be streamed to the LEDMatrix.
+
+  fwbench [--frames n] [--in-flight n] [--scale] <device>
+    Streams n changing frames (500 by default) to <device> with blocking
+    'M' commands ('N' with --scale), keeping up to --in-flight frames sent
+    ahead of their responses (2 by default). Reports the sustained frame
+    rate, response latency percentiles and the serial bytes of each frame.
+
+  <device> is the module's serial port (such as /dev/ttyACM0), or the link
+  of `fwtrace serve` to measure the host build of the firmware.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "ledmatrix.h"
+
+
+//    *** Constants ***
+
+const unsigned framesDefault = 500;
+
+// Frames generated ahead of time, so generating them is not measured.
+const unsigned patternFrames = 34;
+
+
+//    *** Helpers ***
+
+uint64_t monotonicMicros() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return uint64_t(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+}
+
+uint64_t percentile(std::vector<uint64_t> values, unsigned percent) {
+  if (values.empty()) return 0;
+  std::sort(values.begin(), values.end());
+  return values[(values.size() - 1) * percent / 100];
+}
+
+int usage() {
+  fprintf(stderr, "usage: fwbench [--frames n] [--in-flight n] [--scale] <device>\n");
+  return 2;
+}
+
+
+int main(int argc, char **argv) {
+  unsigned frames = framesDefault;
+  size_t inFlight = ledmatrix::inFlightDefault;
+  bool scale = false;
+
+  int i = 1;
+  for (; i < argc && strncmp(argv[i], "--", 2) == 0; i++) {
+    std::string option = argv[i];
+    if (option == "--scale") {
+      scale = true;
+      continue;
+    }
+    if (i + 1 >= argc) return usage();
+    unsigned long value = strtoul(argv[++i], nullptr, 0);
+    if (option == "--frames") frames = value;
+    else if (option == "--in-flight") inFlight = value;
+    else return usage();
+  }
+  if (i + 1 != argc || frames == 0 || inFlight == 0) return usage();
+  const char *devicePath = argv[i];
+
+  // A bar moving down a gradient, so every frame differs from the last.
+  std::vector<std::vector<uint8_t>> pattern(patternFrames, std::vector<uint8_t>(ledmatrix::pixels));
+  for (unsigned f = 0; f < patternFrames; f++) {
+    for (int y = 0; y < ledmatrix::height; y++) {
+      for (int x = 0; x < ledmatrix::width; x++) {
+        uint8_t value = scale ? 0x80 + y : y * 4 + x;
+        pattern[f][y * ledmatrix::width + x] = unsigned(y) == f ? 0xFF : value;
+      }
+    }
+  }
+
+  ledmatrix::Module module;
+  std::string error;
+  if (!module.open(devicePath, error)) {
+    fprintf(stderr, "fwbench: %s\n", error.c_str());
+    return 1;
+  }
+  module.setMaxInFlight(inFlight);
+  if (!module.supports(scale ? 'N' : 'M')) {
+    fprintf(stderr, "fwbench: %s does not support '%c'\n", devicePath, scale ? 'N' : 'M');
+    return 1;
+  }
+
+  uint64_t start = monotonicMicros();
+  for (unsigned f = 0; f < frames; f++) {
+    const uint8_t *frame = pattern[f % patternFrames].data();
+    bool sent = scale ? module.writeScale(frame, true) : module.writeFrame(frame, true);
+    if (!sent) {
+      fprintf(stderr, "fwbench: the module stopped responding after %u frames\n", f);
+      return 1;
+    }
+  }
+  if (!module.drain()) {
+    fprintf(stderr, "fwbench: the module stopped responding with %zu frames in flight\n", module.inFlight());
+    return 1;
+  }
+  uint64_t duration = monotonicMicros() - start;
+
+  const std::vector<uint64_t> &ack = module.ackMicros();
+  printf("device              %s\n", devicePath);
+  printf("command             '%c'\n", scale ? 'N' : 'M');
+  printf("frames              %u\n", frames);
+  printf("in_flight           %zu\n", inFlight);
+  printf("duration_us         %llu\n", (unsigned long long)duration);
+  printf("fps                 %.1f\n", frames * 1e6 / duration);
+  printf("bytes_per_frame     %.1f\n", double(module.bytesWritten()) / frames);
+  printf("ack_p50_us          %llu\n", (unsigned long long)percentile(ack, 50));
+  printf("ack_p90_us          %llu\n", (unsigned long long)percentile(ack, 90));
+  printf("ack_p99_us          %llu\n", (unsigned long long)percentile(ack, 99));
+  printf("ack_max_us          %llu\n", (unsigned long long)percentile(ack, 100));
+  for (const std::string &message : module.messages()) {
+    printf("message             %s\n", message.c_str());
+  }
+  return 0;
+}
@@ -0,0 +1,105 @@
+/*
+  Written by sigroot (github.com/sigroot)
+
+  fwcheck.cpp - Checks properties of the host build of the firmware that a
+  single replayed trace can not show, by comparing the matrix registers
+  before and after a command.
+
+  fwcheck
+    Runs every check and prints a line for each case that fails, then a
+    summary. Exits with 1 if any case failed.
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "shim/host_runtime.h"
+
+
+//    *** Constants ***
+
+// Time given to the firmware to boot before the first check.
+const host::Micros bootMicros = 5000000;
+
+// Time given to a command to finish before the registers are read.
+const host::Micros settleMicros = 100000;
+
+// Time a preemptible pattern runs before it is interrupted.
+const host::Micros patternMicros = 150000;
+
+// The PWM pages of the matrix controller.
+const int pwmPages = 2;
+
+
+//    *** Helpers ***
+
+host::Micros clock = bootMicros;
+int failures = 0;
+int cases = 0;
+
+// Send bytes to the firmware now, then run it until they have settled.
+void send(std::vector<uint8_t> bytes, host::Micros settle = settleMicros) {
+  host::feedSerial(clock, bytes.data(), bytes.size());
+  clock += settle;
+  host::run(clock);
+}
+
+std::vector<uint8_t> pwmRegisters() {
+  const host::MatrixModel &model = host::matrix();
+  std::vector<uint8_t> registers;
+  for (int page = 0; page < pwmPages; page++) {
+    registers.insert(registers.end(), model.registers[page], model.registers[page] + 256);
+  }
+  return registers;
+}
+
+
+//    *** Checks ***
+
+// Setting the same transform again ('o') redraws what is displayed, so it
+// must not change any LED, whether the frame was uploaded with gamma
+// correction (the startup animation) or without it ('m').
+void checkRedraw() {
+  const uint8_t flagsCases[] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07};
+  const uint8_t brightnessCases[] = {255, 96};
+  const char sources[] = "am";
+
+  for (uint8_t flags : flagsCases) {
+    for (uint8_t brightness : brightnessCases) {
+      for (const char *source = sources; *source; source++) {
+        send({'o', flags, brightness});
+        if (*source == 'a') {
+          // Run the animation for a while, then stop it with a no-op.
+          send({'a'}, patternMicros);
+          send({0});
+        } else {
+          std::vector<uint8_t> frame = {'m'};
+          for (int i = 0; i < 306; i++) frame.push_back(i * 37 + 11);
+          send(frame);
+        }
+
+        std::vector<uint8_t> before = pwmRegisters();
+        send({'o', flags, brightness});
+        cases++;
+        if (pwmRegisters() != before) {
+          failures++;
+          printf("redraw: flags=0x%02x brightness=%u source='%c' changed the PWM\n", flags, brightness, *source);
+        }
+      }
+    }
+  }
+}
+
+
+int main() {
+  host::begin(1);
+  host::run(clock);
+
+  checkRedraw();
+
+  printf("fwcheck: %d of %d cases pass\n", cases - failures, cases);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,404 @@
+/*
+  Written by sigroot (github.com/sigroot)
+
+  fwtrace.cpp - Records serial traffic to the LEDMatrix and replays it through
+  the host build of the firmware.
+
+  fwtrace record <device> <link> <trace>
+    Creates a pseudo terminal, links it at <link> and forwards everything
+    between it and <device> until interrupted, recording both directions
+    with timestamps. Point the host program at <link> instead of the module.
+
+  fwtrace dump <trace>
+    Prints every record of a trace.
+
+  fwtrace replay [--seed n] [--boot-ms n] [--tail-ms n] <trace>
+    Feeds the host to module bytes of a trace into the host firmware on a
+    virtual clock and reports latency, frames and I2C traffic. Replays with
+    the same seed are identical, so reports can be compared between
+    firmware versions.
+
+  fwtrace serve [--seed n] <link>
+    Runs the host firmware in real time behind a pseudo terminal linked at
+    <link> until interrupted, so host programs (such as fwbench) can talk to
+    it as if it were a module.
+
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "shim/host_runtime.h"
+#include "trace.h"
+
+
+//    *** Constants ***
+
+// Commands that upload a full frame and are expected to present it.
+const char frameCommands[] = "mM";
+
+// Default time given to the firmware to boot before the trace starts.
+const uint64_t bootMillisDefault = 5000;
+
+// Default time the firmware keeps running after the last traced byte.
+const uint64_t tailMillisDefault = 1000;
+
+
+//    *** Helpers ***
+
+volatile sig_atomic_t interrupted = 0;
+
+void onInterrupt(int) {
+  interrupted = 1;
+}
+
+uint64_t monotonicMicros() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return uint64_t(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+}
+
+bool setRaw(int fd) {
+  termios settings;
+  if (tcgetattr(fd, &settings) != 0) return false;
+  cfmakeraw(&settings);
+  return tcsetattr(fd, TCSANOW, &settings) == 0;
+}
+
+std::string opcodeName(uint8_t opcode) {
+  if (opcode >= 0x21 && opcode <= 0x7E) return std::string("'") + char(opcode) + "'";
+  return std::to_string(opcode);
+}
+
+uint64_t percentile(std::vector<uint64_t> values, unsigned percent) {
+  if (values.empty()) return 0;
+  std::sort(values.begin(), values.end());
+  return values[(values.size() - 1) * percent / 100];
+}
+
+int usage() {
+  fprintf(stderr,
+          "usage: fwtrace record <device> <link> <trace>\n"
+          "       fwtrace dump <trace>\n"
+          "       fwtrace replay [--seed n] [--boot-ms n] [--tail-ms n] <trace>\n"
+          "       fwtrace serve [--seed n] <link>\n");
+  return 2;
+}
+
+// Creates a raw pseudo terminal and links its slave at linkPath. Returns the
+// master, or -1 after printing why.
+int openLink(const char *linkPath) {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+    fprintf(stderr, "fwtrace: can not create pseudo terminal: %s\n", strerror(errno));
+    return -1;
+  }
+
+  // Hold the slave open so the link survives the host program reconnecting.
+  // It is never closed, as the process exits with the link.
+  const char *slavePath = ptsname(master);
+  int slave = open(slavePath, O_RDWR | O_NOCTTY);
+  if (slave < 0 || !setRaw(slave)) {
+    fprintf(stderr, "fwtrace: can not open %s: %s\n", slavePath, strerror(errno));
+    return -1;
+  }
+
+  unlink(linkPath);
+  if (symlink(slavePath, linkPath) != 0) {
+    fprintf(stderr, "fwtrace: can not link %s: %s\n", linkPath, strerror(errno));
+    return -1;
+  }
+  return master;
+}
+
+
+//    *** record ***
+
+int record(const char *devicePath, const char *linkPath, const char *tracePath) {
+  int device = open(devicePath, O_RDWR | O_NOCTTY);
+  if (device < 0 || !setRaw(device)) {
+    fprintf(stderr, "fwtrace: can not open %s: %s\n", devicePath, strerror(errno));
+    return 1;
+  }
+
+  int master = openLink(linkPath);
+  if (master < 0) return 1;
+
+  trace::Writer writer;
+  if (!writer.open(tracePath)) {
+    fprintf(stderr, "fwtrace: can not write %s\n", tracePath);
+    unlink(linkPath);
+    return 1;
+  }
+
+  signal(SIGINT, onInterrupt);
+  signal(SIGTERM, onInterrupt);
+  fprintf(stderr, "fwtrace: recording %s <-> %s to %s\n", linkPath, devicePath, tracePath);
+
+  uint64_t start = monotonicMicros();
+  uint64_t bytesIn = 0, bytesOut = 0;
+  uint8_t buffer[4096];
+  pollfd fds[2] = {{master, POLLIN, 0}, {device, POLLIN, 0}};
+
+  while (!interrupted) {
+    if (poll(fds, 2, 100) < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+
+    if (fds[0].revents & POLLIN) {
+      ssize_t length = read(master, buffer, sizeof(buffer));
+      if (length > 0) {
+        writer.write(monotonicMicros() - start, trace::toModule, buffer, length);
+        if (write(device, buffer, length) != length) break;
+        bytesIn += length;
+      }
+    }
+    if (fds[1].revents & POLLIN) {
+      ssize_t length = read(device, buffer, sizeof(buffer));
+      if (length <= 0) break;
+      writer.write(monotonicMicros() - start, trace::toHost, buffer, length);
+      if (write(master, buffer, length) != length) break;
+      bytesOut += length;
+    }
+    if (fds[1].revents & (POLLERR | POLLHUP)) break;
+  }
+
+  writer.close();
+  unlink(linkPath);
+  fprintf(stderr, "fwtrace: recorded %llu bytes to module, %llu bytes to host\n",
+          (unsigned long long)bytesIn, (unsigned long long)bytesOut);
+  return 0;
+}
+
+
+//    *** dump ***
+
+int dump(const char *tracePath) {
+  std::vector<trace::Record> records;
+  std::string error;
+  if (!trace::read(tracePath, records, error)) {
+    fprintf(stderr, "fwtrace: %s\n", error.c_str());
+    return 1;
+  }
+
+  for (const trace::Record &record : records) {
+    printf("%12llu %s %5zu ", (unsigned long long)record.at,
+           record.direction == trace::toModule ? ">" : "<", record.data.size());
+    for (size_t i = 0; i < record.data.size() && i < 24; i++) {
+      printf(" %02x", record.data[i]);
+    }
+    printf(record.data.size() > 24 ? " ...\n" : "\n");
+  }
+  return 0;
+}
+
+
+//    *** replay ***
+
+int replay(uint32_t seed, uint64_t bootMillis, uint64_t tailMillis, const char *tracePath) {
+  std::vector<trace::Record> records;
+  std::string error;
+  if (!trace::read(tracePath, records, error)) {
+    fprintf(stderr, "fwtrace: %s\n", error.c_str());
+    return 1;
+  }
+
+  host::Micros offset = bootMillis * 1000;
+  uint64_t bytesIn = 0, recordedOut = 0, bytesOut = 0;
+  for (const trace::Record &record : records) {
+    if (record.direction == trace::toModule) {
+      host::feedSerial(offset + record.at, record.data.data(), record.data.size());
+      bytesIn += record.data.size();
+    } else {
+      recordedOut += record.data.size();
+    }
+  }
+  host::onSerialOutput([&](host::Micros at, uint8_t) {
+    if (at >= offset) bytesOut++;
+  });
+
+  // Boot the firmware, then measure only what the trace causes.
+  host::begin(seed);
+  host::run(offset);
+  host::I2CStats bootI2C = host::i2c();
+  size_t bootCommands = host::commands().size();
+
+  host::Micros end = std::max(host::lastArrival(), offset) + tailMillis * 1000;
+  host::run(end);
+
+  const host::I2CStats &i2c = host::i2c();
+  uint64_t transactions = i2c.transactions - bootI2C.transactions;
+  uint64_t i2cBytes = i2c.bytes - bootI2C.bytes;
+  uint64_t busy = i2c.busyMicros - bootI2C.busyMicros;
+  uint64_t frames = i2c.framesPresented - bootI2C.framesPresented;
+
+  struct OpcodeStats {
+    std::vector<uint64_t> dispatch;
+    std::vector<uint64_t> complete;
+    uint64_t running = 0;
+  };
+  std::map<uint8_t, OpcodeStats> opcodes;
+  uint64_t frameCommandCount = 0, dropped = 0;
+
+  const std::vector<host::CommandRecord> &commands = host::commands();
+  for (size_t i = bootCommands; i < commands.size(); i++) {
+    const host::CommandRecord &command = commands[i];
+    OpcodeStats &stats = opcodes[command.opcode];
+    stats.dispatch.push_back(command.dispatched - command.arrived);
+
+    if (command.completed == 0) {
+      stats.running++;
+      continue;
+    }
+    stats.complete.push_back(command.completed - command.arrived);
+
+    if (strchr(frameCommands, command.opcode) && command.opcode != 0) {
+      frameCommandCount++;
+      if (command.framesPresented == 0) dropped++;
+    }
+  }
+
+  // FNV-1a of the final controller registers, to spot behaviour changes.
+  uint32_t hash = 2166136261u;
+  const host::MatrixModel &matrix = host::matrix();
+  for (size_t page = 0; page < 5; page++) {
+    for (size_t reg = 0; reg < 256; reg++) {
+      hash = (hash ^ matrix.registers[page][reg]) * 16777619u;
+    }
+  }
+
+  uint64_t duration = end - offset;
+  printf("trace               %s\n", tracePath);
+  printf("seed                %u\n", seed);
+  printf("duration_us         %llu\n", (unsigned long long)duration);
+  printf("bytes_in            %llu\n", (unsigned long long)bytesIn);
+  printf("bytes_out           %llu\n", (unsigned long long)bytesOut);
+  printf("recorded_bytes_out  %llu\n", (unsigned long long)recordedOut);
+  printf("commands            %zu\n", commands.size() - bootCommands);
+  printf("frames_presented    %llu\n", (unsigned long long)frames);
+  printf("frame_commands      %llu\n", (unsigned long long)frameCommandCount);
+  printf("dropped_frames      %llu\n", (unsigned long long)dropped);
+  printf("i2c_transactions    %llu\n", (unsigned long long)transactions);
+  printf("i2c_bytes           %llu\n", (unsigned long long)i2cBytes);
+  printf("i2c_busy_pct        %.1f\n", duration ? 100.0 * busy / duration : 0.0);
+  printf("rebooted            %s\n", host::rebooted() ? "yes" : "no");
+  printf("matrix_hash         %08x\n", hash);
+  printf("\n%-8s %7s %8s %12s %12s %12s %12s %12s %12s\n", "opcode", "count", "running",
+         "dispatch_p50", "dispatch_p99", "dispatch_max", "done_p50", "done_p99", "done_max");
+  for (const auto &entry : opcodes) {
+    const OpcodeStats &stats = entry.second;
+    printf("%-8s %7zu %8llu %12llu %12llu %12llu %12llu %12llu %12llu\n",
+           opcodeName(entry.first).c_str(), stats.dispatch.size(),
+           (unsigned long long)stats.running,
+           (unsigned long long)percentile(stats.dispatch, 50),
+           (unsigned long long)percentile(stats.dispatch, 99),
+           (unsigned long long)percentile(stats.dispatch, 100),
+           (unsigned long long)percentile(stats.complete, 50),
+           (unsigned long long)percentile(stats.complete, 99),
+           (unsigned long long)percentile(stats.complete, 100));
+  }
+  return 0;
+}
+
+
+//    *** serve ***
+
+int serve(uint32_t seed, const char *linkPath) {
+  int master = openLink(linkPath);
+  if (master < 0) return 1;
+
+  // Serial output is collected while the firmware runs and sent after.
+  std::vector<uint8_t> output;
+  host::onSerialOutput([&](host::Micros, uint8_t value) { output.push_back(value); });
+  host::begin(seed);
+
+  signal(SIGINT, onInterrupt);
+  signal(SIGTERM, onInterrupt);
+  fprintf(stderr, "fwtrace: serving the host firmware at %s\n", linkPath);
+
+  // The virtual clock follows the monotonic clock, so bytes arrive when they
+  // are written and I2C transfers take as long as on a module.
+  uint64_t start = monotonicMicros();
+  uint64_t bytesIn = 0, bytesOut = 0;
+  uint8_t buffer[4096];
+  pollfd fds[1] = {{master, POLLIN, 0}};
+
+  while (!interrupted && !host::rebooted()) {
+    if (poll(fds, 1, 1) < 0 && errno != EINTR) break;
+
+    host::Micros now = monotonicMicros() - start;
+    if (fds[0].revents & POLLIN) {
+      ssize_t length = read(master, buffer, sizeof(buffer));
+      if (length > 0) {
+        host::feedSerial(now, buffer, length);
+        bytesIn += length;
+      }
+    }
+
+    host::run(now);
+    if (!output.empty()) {
+      if (write(master, output.data(), output.size()) != ssize_t(output.size())) break;
+      bytesOut += output.size();
+      output.clear();
+    }
+  }
+
+  unlink(linkPath);
+  fprintf(stderr, "fwtrace: served %llu bytes to module, %llu bytes to host%s\n",
+          (unsigned long long)bytesIn, (unsigned long long)bytesOut,
+          host::rebooted() ? " before the firmware rebooted" : "");
+  return 0;
+}
+
+
+int main(int argc, char **argv) {
+  if (argc < 2) return usage();
+  std::string mode = argv[1];
+
+  if (mode == "record" && argc == 5) return record(argv[2], argv[3], argv[4]);
+  if (mode == "dump" && argc == 3) return dump(argv[2]);
+
+  if (mode == "replay") {
+    uint32_t seed = 1;
+    uint64_t bootMillis = bootMillisDefault;
+    uint64_t tailMillis = tailMillisDefault;
+    int i = 2;
+    for (; i + 1 < argc && strncmp(argv[i], "--", 2) == 0; i += 2) {
+      std::string option = argv[i];
+      unsigned long long value = strtoull(argv[i + 1], nullptr, 0);
+      if (option == "--seed") seed = value;
+      else if (option == "--boot-ms") bootMillis = value;
+      else if (option == "--tail-ms") tailMillis = value;
+      else return usage();
+    }
+    if (i + 1 != argc) return usage();
+    return replay(seed, bootMillis, tailMillis, argv[i]);
+  }
+
+  if (mode == "serve") {
+    uint32_t seed = 1;
+    int i = 2;
+    for (; i + 1 < argc && strncmp(argv[i], "--", 2) == 0; i += 2) {
+      if (strcmp(argv[i], "--seed") != 0) return usage();
+      seed = strtoul(argv[i + 1], nullptr, 0);
+    }
+    if (i + 1 != argc) return usage();
+    return serve(seed, argv[i]);
+  }
+
+  return usage();
+}
@@ -0,0 +1,276 @@
+/*
+  Written by sigroot (github.com/sigroot)
+
+  ledmatrix.cpp - Streaming client for the LEDMatrix firmware.
+
+*/
+
+#include "ledmatrix.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace ledmatrix {
+
+namespace {
+
+uint64_t monotonicMicros() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return uint64_t(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+}
+
+}  // namespace
+
+Module::~Module() {
+  close();
+}
+
+bool Module::open(const std::string &path, std::string &error) {
+  close();
+  fd_ = ::open(path.c_str(), O_RDWR | O_NOCTTY);
+  if (fd_ < 0) {
+    error = "can not open " + path + ": " + strerror(errno);
+    return false;
+  }
+
+  termios settings;
+  if (tcgetattr(fd_, &settings) != 0) {
+    error = path + " is not a serial port";
+    close();
+    return false;
+  }
+  cfmakeraw(&settings);
+  tcsetattr(fd_, TCSANOW, &settings);
+  tcflush(fd_, TCIOFLUSH);
+
+  // The module drops a command whose bytes have not all arrived
+  // commandTimeout after its opcode. Send nothing for longer than that, so a
+  // command an earlier program left unfinished can not shift the commands
+  // that follow, then clear the queue ('c') and send a no-op.
+  usleep((commandTimeout + 50) * 1000);
+  const uint8_t clear = 'c';
+  const uint8_t noop = 0;
+  command(&clear, 1);
+  if (!command(&noop, 1)) {
+    error = "can not write to " + path + ": " + strerror(errno);
+    close();
+    return false;
+  }
+
+  // Drop anything the module printed before now.
+  uint8_t discard[512];
+  pollfd fds = {fd_, POLLIN, 0};
+  while (poll(&fds, 1, 50) > 0 && read(fd_, discard, sizeof(discard)) > 0) {
+  }
+  clearStats();
+  return true;
+}
+
+void Module::close() {
+  if (fd_ >= 0) ::close(fd_);
+  fd_ = -1;
+  inFlight_.clear();
+  messages_.clear();
+  line_.clear();
+  inLine_ = false;
+  commandsQueried_ = false;
+}
+
+void Module::setMaxInFlight(size_t frames) {
+  maxInFlight_ = frames > 0 ? frames : 1;
+}
+
+void Module::clearStats() {
+  ackMicros_.clear();
+  bytesWritten_ = 0;
+}
+
+
+//    *** Commands ***
+
+bool Module::writeFrame(const uint8_t *frame, bool blocking) {
+  return sendFrame(blocking ? 'M' : 'm', nullptr, 0, frame);
+}
+
+bool Module::writeScale(const uint8_t *frame, bool blocking) {
+  return sendFrame(blocking ? 'N' : 'n', nullptr, 0, frame);
+}
+
+bool Module::transition(const uint8_t *frame, uint16_t durationMillis, uint8_t curve) {
+  uint8_t header[3] = {uint8_t(durationMillis >> 8), uint8_t(durationMillis), curve};
+  return sendFrame('i', header, sizeof(header), frame);
+}
+
+bool Module::storeFrame(uint8_t slot, const uint8_t *frame) {
+  return sendFrame('k', &slot, 1, frame);
+}
+
+bool Module::writeCanvas(uint8_t onPWM, uint8_t offPWM, const uint8_t *packed) {
+  uint8_t header[3] = {'l', onPWM, offPWM};
+  iovec parts[2] = {{header, sizeof(header)}, {const_cast<uint8_t *>(packed), packedBytes}};
+  return send(parts, 2);
+}
+
+bool Module::setPixel(uint8_t x, uint8_t y, uint8_t pwm) {
+  uint8_t data[4] = {'p', x, y, pwm};
+  return command(data, sizeof(data));
+}
+
+bool Module::setPixelScale(uint8_t x, uint8_t y, uint8_t scale) {
+  uint8_t data[4] = {'q', x, y, scale};
+  return command(data, sizeof(data));
+}
+
+bool Module::drawCanvas(uint8_t operation, uint8_t shape, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1) {
+  uint8_t data[7] = {'j', operation, shape, x0, y0, x1, y1};
+  return command(data, sizeof(data));
+}
+
+bool Module::command(const uint8_t *data, size_t length) {
+  iovec part = {const_cast<uint8_t *>(data), length};
+  return send(&part, 1);
+}
+
+bool Module::sendFrame(uint8_t opcode, const uint8_t *header, size_t headerLength, const uint8_t *frame) {
+  bool blocking = opcode == 'M' || opcode == 'N';
+  if (blocking && !drain(maxInFlight_ - 1)) return false;
+
+  iovec parts[3] = {
+    {&opcode, 1},
+    {const_cast<uint8_t *>(header), headerLength},
+    {const_cast<uint8_t *>(frame), size_t(pixels)},
+  };
+  if (!send(parts, 3)) return false;
+
+  if (blocking) inFlight_.push_back({opcode, monotonicMicros()});
+  return true;
+}
+
+bool Module::send(iovec *parts, int count) {
+  if (fd_ < 0) return false;
+
+  while (count > 0) {
+    ssize_t written = writev(fd_, parts, count);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    bytesWritten_ += written;
+
+    // Skip the parts that were written whole, then the written start of the
+    // next one.
+    while (count > 0 && size_t(written) >= parts->iov_len) {
+      written -= parts->iov_len;
+      parts++;
+      count--;
+    }
+    if (count > 0) {
+      parts->iov_base = static_cast<uint8_t *>(parts->iov_base) + written;
+      parts->iov_len -= written;
+    }
+  }
+  return true;
+}
+
+
+//    *** Responses ***
+
+bool Module::drain(size_t frames, int timeoutMillis) {
+  uint64_t deadline = monotonicMicros() + uint64_t(timeoutMillis) * 1000;
+  while (inFlight_.size() > frames) {
+    uint64_t now = monotonicMicros();
+    if (now >= deadline || !receive((deadline - now + 999) / 1000)) return false;
+  }
+  return true;
+}
+
+bool Module::query(uint8_t opcode, std::string &line, int timeoutMillis) {
+  if (!drain(0, timeoutMillis)) return false;
+
+  size_t before = messages_.size();
+  if (!command(&opcode, 1)) return false;
+
+  uint64_t deadline = monotonicMicros() + uint64_t(timeoutMillis) * 1000;
+  while (messages_.size() == before) {
+    uint64_t now = monotonicMicros();
+    if (now >= deadline || !receive((deadline - now + 999) / 1000)) break;
+  }
+
+  if (messages_.size() > before) {
+    line = messages_[before];
+    messages_.erase(messages_.begin() + before);
+    return true;
+  }
+  // Some reports (such as the version) end without a new line.
+  if (inLine_ && !line_.empty()) {
+    line = line_;
+    line_.clear();
+    inLine_ = false;
+    return true;
+  }
+  return false;
+}
+
+bool Module::supports(uint8_t opcode) {
+  if (!commandsQueried_) {
+    commandsQueried_ = true;
+    commands_.set();
+
+    // A report of "COMMANDS 00:0 61:0:p ...", opcodes in hexadecimal.
+    std::string line;
+    if (query('C', line) && line.compare(0, 9, "COMMANDS ") == 0) {
+      commands_.reset();
+      for (size_t at = line.find(' '); at != std::string::npos; at = line.find(' ', at + 1)) {
+        commands_.set(strtoul(line.c_str() + at + 1, nullptr, 16) & 0xFF);
+      }
+    }
+  }
+  return commands_.test(opcode);
+}
+
+bool Module::receive(int timeoutMillis) {
+  if (fd_ < 0) return false;
+
+  pollfd fds = {fd_, POLLIN, 0};
+  int ready = poll(&fds, 1, timeoutMillis);
+  if (ready < 0) return errno == EINTR;
+  if (ready == 0) return true;
+
+  uint8_t buffer[512];
+  ssize_t length = read(fd_, buffer, sizeof(buffer));
+  if (length <= 0) return length < 0 && (errno == EINTR || errno == EAGAIN);
+
+  uint64_t at = monotonicMicros();
+  for (ssize_t i = 0; i < length; i++) {
+    parse(buffer[i], at);
+  }
+  return true;
+}
+
+// Responses to frames are single bytes. Anything else is a line of text.
+void Module::parse(uint8_t value, uint64_t at) {
+  if (!inLine_ && !inFlight_.empty() && value == inFlight_.front().opcode) {
+    ackMicros_.push_back(at - inFlight_.front().sent);
+    inFlight_.pop_front();
+    return;
+  }
+
+  if (value == '\n') {
+    if (!line_.empty() && line_.back() == '\r') line_.pop_back();
+    messages_.push_back(line_);
+    line_.clear();
+    inLine_ = false;
+  } else {
+    line_ += char(value);
+    inLine_ = true;
+  }
+}
+
+}  // namespace ledmatrix
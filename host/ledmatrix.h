@@ -0,0 +1,133 @@
+/*
+  Written by sigroot (github.com/sigroot)
+
+  ledmatrix.h - Streaming client for the LEDMatrix firmware over its USB
+  serial port.
+
+  Commands are written straight from the caller's buffers with writev, so a
+  frame is never copied in user space. Frames sent with a response ('M' and
+  'N') are kept in flight: up to a set number may be sent before their
+  responses arrive, which keeps the module busy without letting the serial
+  buffers grow. Once a call returns, its buffers may be reused.
+
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include <bitset>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace ledmatrix {
+
+const int width = 9;
+const int height = 34;
+const int pixels = width * height;
+
+// The bytes of a packed 1 bit frame for the canvas.
+const int packedBytes = 39;
+
+// Default number of blocking frames sent ahead of their responses.
+const size_t inFlightDefault = 2;
+
+// How long to wait for the module before giving up, in milliseconds.
+const int timeoutDefault = 1000;
+
+// How long the module waits for the rest of a command once its opcode has
+// arrived, in milliseconds. A command unfinished by then is dropped.
+const int commandTimeout = 100;
+
+class Module {
+ public:
+  ~Module();
+
+  // Opens the serial port (or a pseudo terminal from `fwtrace serve`) in raw
+  // mode, then brings the module's command queue into step. Returns false
+  // and sets error if the port can not be used.
+  bool open(const std::string &path, std::string &error);
+  void close();
+
+  // The number of blocking frames sent before waiting for the oldest
+  // response. At least 1.
+  void setMaxInFlight(size_t frames);
+  size_t inFlight() const { return inFlight_.size(); }
+
+  // Full frames of 306 values in reading order ('m', 'M', 'n' and 'N').
+  // Blocking frames wait for room in flight first.
+  bool writeFrame(const uint8_t *frame, bool blocking);
+  bool writeScale(const uint8_t *frame, bool blocking);
+
+  // Transition to a frame ('i'), or store it in a slot for crossfades ('k').
+  bool transition(const uint8_t *frame, uint16_t durationMillis, uint8_t curve);
+  bool storeFrame(uint8_t slot, const uint8_t *frame);
+
+  // Replace the canvas with a packed frame of 39 bytes ('l').
+  bool writeCanvas(uint8_t onPWM, uint8_t offPWM, const uint8_t *packed);
+
+  // Change part of the matrix: one pixel ('p' and 'q') or a shape on the
+  // canvas ('j').
+  bool setPixel(uint8_t x, uint8_t y, uint8_t pwm);
+  bool setPixelScale(uint8_t x, uint8_t y, uint8_t scale);
+  bool drawCanvas(uint8_t operation, uint8_t shape, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1);
+
+  // Any other command, opcode first.
+  bool command(const uint8_t *data, size_t length);
+
+  // Waits until no more than frames blocking frames are in flight. Returns
+  // false if the module stops responding.
+  bool drain(size_t frames = 0, int timeoutMillis = timeoutDefault);
+
+  // Sends a report command once every frame in flight is done, and reads the
+  // line it prints.
+  bool query(uint8_t opcode, std::string &line, int timeoutMillis = timeoutDefault);
+
+  // Whether the module accepts a command, from the table it reports ('C')
+  // the first time this is called. Firmware too old to report its commands
+  // is assumed to accept every one.
+  bool supports(uint8_t opcode);
+
+  // Microseconds from sending each acknowledged frame to its response, and
+  // every byte written since open or the last clearStats.
+  const std::vector<uint64_t> &ackMicros() const { return ackMicros_; }
+  uint64_t bytesWritten() const { return bytesWritten_; }
+  void clearStats();
+
+  // Text the module printed that was not a response to a frame, such as
+  // ERROR lines.
+  const std::vector<std::string> &messages() const { return messages_; }
+
+ private:
+  struct Pending {
+    uint8_t opcode;
+    uint64_t sent;
+  };
+
+  bool send(iovec *parts, int count);
+  bool sendFrame(uint8_t opcode, const uint8_t *header, size_t headerLength, const uint8_t *frame);
+  // Reads whatever the module has sent within timeoutMillis. Returns false
+  // on a read error.
+  bool receive(int timeoutMillis);
+  void parse(uint8_t value, uint64_t at);
+
+  int fd_ = -1;
+  size_t maxInFlight_ = inFlightDefault;
+  std::deque<Pending> inFlight_;
+  std::vector<uint64_t> ackMicros_;
+  uint64_t bytesWritten_ = 0;
+
+  // Text being received, and whether a line is in progress.
+  std::string line_;
+  bool inLine_ = false;
+  std::vector<std::string> messages_;
+
+  // The opcodes the module reported, once asked.
+  std::bitset<256> commands_;
+  bool commandsQueried_ = false;
+};
+
+}  // namespace ledmatrix
@@ -0,0 +1,159 @@
+/*
+  Written by sigroot (github.com/sigroot)
+
+  Arduino.h - Minimal Arduino and arduino-pico API used to build the LEDMatrix
+  firmware on a Linux host. Time is virtual and both rp2040 cores are run
+  cooperatively by host_runtime.cpp so every run is deterministic.
+
+*/
+
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <type_traits>
+
+
+//    *** Constants ***
+
+#define PI 3.1415926535897932384626433832795
+#define HIGH 1
+#define LOW 0
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define INPUT 0
+#define OUTPUT 1
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+
+//    *** Helpers ***
+
+template <typename T, typename L>
+typename std::common_type<T, L>::type min(const T &a, const L &b) {
+  return (b < a) ? b : a;
+}
+
+template <typename T, typename L>
+typename std::common_type<T, L>::type max(const T &a, const L &b) {
+  return (a < b) ? b : a;
+}
+
+template <typename T, typename L, typename H>
+typename std::common_type<T, L, H>::type constrain(const T &amt, const L &low, const H &high) {
+  return (amt < low) ? low : ((amt > high) ? high : amt);
+}
+
+
+//    *** Time, randomness and pins ***
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// Pico SDK hint placed in busy-wait loops. Lets the other core run.
+void tight_loop_contents();
+
+// Wait for and send events between the cores. Waiting only lets the other
+// core run, as on the module an interrupt or event could end it at any time.
+void __wfe();
+void __sev();
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+void rom_reset_usb_boot(uint32_t gpioMask, uint32_t disableInterfaceMask);
+
+
+//    *** String ***
+
+class String {
+ public:
+  String(const char *text = "") : text_(text) {}
+  String(const std::string &text) : text_(text) {}
+  const char *c_str() const { return text_.c_str(); }
+  unsigned int length() const { return text_.size(); }
+
+ private:
+  std::string text_;
+};
+
+
+//    *** Serial ***
+
+class HostSerial {
+ public:
+  void begin(unsigned long baud) { (void)baud; }
+  void end() {}
+  void setTimeout(unsigned long ms) { timeout_ = ms; }
+  void flush() {}
+  operator bool() const { return true; }
+
+  int available();
+  int read();
+  size_t readBytes(uint8_t *buffer, size_t length);
+  size_t readBytes(char *buffer, size_t length) { return readBytes((uint8_t *)buffer, length); }
+
+  size_t write(uint8_t value);
+  size_t write(const uint8_t *buffer, size_t length);
+
+  size_t print(const char *text) { return write((const uint8_t *)text, strlen(text)); }
+  size_t print(const String &text) { return print(text.c_str()); }
+  size_t print(char value) { return write(uint8_t(value)); }
+  size_t print(double value) { return print(std::to_string(value).c_str()); }
+  template <typename T>
+  typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, char>::value, size_t>::type
+  print(T value) { return print(std::to_string(value).c_str()); }
+  template <typename T>
+  typename std::enable_if<std::is_integral<T>::value, size_t>::type
+  print(T value, int base) {
+    char text[40];
+    const char *format = base == HEX ? "%llX" : base == OCT ? "%llo" : "%llu";
+    snprintf(text, sizeof(text), format, (unsigned long long)value);
+    return print(text);
+  }
+
+  size_t println() { return print("\r\n"); }
+  template <typename T>
+  size_t println(const T &value) { return print(value) + println(); }
+
+ private:
+  unsigned long timeout_ = 1000;
+};
+
+extern HostSerial Serial;
+
+
+//    *** rp2040 ***
+
+// The inter core FIFO. Like the hardware FIFO it is 8 entries deep and push
+// and pop block while it is full or empty.
+class HostFifo {
+ public:
+  void push(uint32_t value);
+  bool push_nb(uint32_t value);
+  uint32_t pop();
+  bool pop_nb(uint32_t *value);
+  int available();
+  void clear();
+};
+
+class HostRP2040 {
+ public:
+  HostFifo fifo;
+};
+
+extern HostRP2040 rp2040;
@@ -0,0 +1,40 @@
+/*
+  Written by sigroot (github.com/sigroot)
+
+  Wire.h - Host stand in for the arduino-pico I2C driver. Transfers are
+  applied to a model of the IS31FL3741A registers and cost virtual time at
+  the configured I2C clock rate.
+
+*/
+
+#pragma once
+
+#include "Arduino.h"
+
+class TwoWire {
+ public:
+  void setSDA(int pin) { (void)pin; }
+  void setSCL(int pin) { (void)pin; }
+  void begin() {}
+  void end() {}
+  void setClock(uint32_t hz) { clock_ = hz; }
+  uint32_t clock() const { return clock_; }
+
+  void beginTransmission(uint8_t address);
+  size_t write(uint8_t value);
+  uint8_t endTransmission(bool sendStop = true);
+  uint8_t requestFrom(uint8_t address, size_t quantity, bool sendStop = true);
+  int available();
+  int read();
+
+ private:
+  uint32_t clock_ = 100000;
+  uint8_t address_ = 0;
+  uint8_t buffer_[512];
+  size_t length_ = 0;
+  uint8_t response_[32];
+  size_t responseLength_ = 0;
+  size_t responseIndex_ = 0;
+};
+
+extern TwoWire Wire1;
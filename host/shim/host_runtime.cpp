@@ -0,0 +1,479 @@
+/*
+  Written by sigroot (github.com/sigroot)
+
+  host_runtime.cpp - Cooperative two core scheduler, virtual clock, serial,
+  FIFO and IS31FL3741A model behind the host Arduino shim.
+
+*/
+
+#include "host_runtime.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ucontext.h>
+
+#include <deque>
+
+#include "Arduino.h"
+#include "Wire.h"
+
+// The sketch entry points, defined by rp2040_firmware.ino.
+void setup();
+void loop();
+void setup1();
+void loop1();
+
+HostSerial Serial;
+HostRP2040 rp2040;
+TwoWire Wire1;
+
+namespace host {
+namespace {
+
+//    *** Constants ***
+
+// Virtual cost of one pass through loop() or loop1().
+const Micros loopCost = 2;
+
+// Virtual cost of polling serial, the FIFO or I2C while waiting on it.
+const Micros pollCost = 1;
+
+// Stack size of each emulated core.
+const size_t coreStackSize = 512 * 1024;
+
+// Depth of the rp2040 inter core FIFO.
+const size_t fifoDepth = 8;
+
+
+//    *** State ***
+
+struct Core {
+  ucontext_t context;
+  std::vector<char> stack;
+  Micros now;
+};
+
+struct FifoEntry {
+  uint32_t value;
+  // Arrival time of the last serial byte core 0 read before pushing.
+  Micros arrived;
+};
+
+struct SerialByte {
+  Micros at;
+  uint8_t value;
+};
+
+ucontext_t mainContext;
+Core cores[2];
+int current = -1;
+bool started = false;
+bool stopped = false;
+Micros runUntil = 0;
+
+std::deque<SerialByte> serialInput;
+Micros lastReadArrival = 0;
+Micros lastFeedArrival = 0;
+std::function<void(Micros, uint8_t)> serialOutputHandler;
+
+std::deque<FifoEntry> fifo;
+
+std::vector<CommandRecord> commandLog;
+bool awaitingOpcode = false;
+
+I2CStats i2cStats;
+MatrixModel model;
+
+uint32_t randomState = 1;
+
+
+//    *** Scheduler ***
+
+// Pick the core whose clock is furthest behind. Core 0 wins ties.
+int nextCore() {
+  return cores[0].now <= cores[1].now ? 0 : 1;
+}
+
+// Charge the running core for time spent and let the other core catch up.
+void advance(Micros cost) {
+  int self = current;
+  cores[self].now += cost;
+
+  int next = nextCore();
+  if (stopped || cores[next].now >= runUntil) {
+    swapcontext(&cores[self].context, &mainContext);
+  } else if (next != self) {
+    current = next;
+    swapcontext(&cores[self].context, &cores[next].context);
+  }
+  current = self;
+}
+
+void core0Entry() {
+  setup();
+  for (;;) {
+    loop();
+    advance(loopCost);
+  }
+}
+
+void core1Entry() {
+  setup1();
+  for (;;) {
+    awaitingOpcode = true;
+    size_t before = commandLog.size();
+    uint64_t framesBefore = i2cStats.framesPresented;
+
+    loop1();
+
+    awaitingOpcode = false;
+    if (commandLog.size() != before) {
+      commandLog.back().completed = cores[1].now;
+      commandLog.back().framesPresented = i2cStats.framesPresented - framesBefore;
+    }
+    advance(loopCost);
+  }
+}
+
+void startCore(int index, void (*entry)()) {
+  Core &core = cores[index];
+  core.stack.resize(coreStackSize);
+  getcontext(&core.context);
+  core.context.uc_stack.ss_sp = core.stack.data();
+  core.context.uc_stack.ss_size = core.stack.size();
+  core.context.uc_link = &mainContext;
+  makecontext(&core.context, entry, 0);
+}
+
+
+//    *** IS31FL3741A model ***
+
+const uint8_t modelAddress = 0b0110000;
+
+void modelWrite(const uint8_t *data, size_t length) {
+  if (length == 0) return;
+  uint8_t reg = data[0];
+
+  if (reg == 0xFE) {
+    model.unlocked = length > 1 && data[1] == 0xC5;
+    return;
+  }
+  if (reg == 0xFD) {
+    if (model.unlocked && length > 1 && data[1] <= 4) {
+      model.page = data[1];
+    }
+    model.unlocked = false;
+    return;
+  }
+  if (model.page == 4 && reg == 0x3F && length > 1 && data[1] == 0xAE) {
+    memset(model.registers, 0, sizeof(model.registers));
+    model.resets++;
+    return;
+  }
+  for (size_t i = 1; i < length; i++) {
+    model.registers[model.page][uint8_t(reg + i - 1)] = data[i];
+  }
+
+  // Every full frame upload ends with a bulk write of the second PWM page.
+  if (model.page == 1 && length > 16) {
+    i2cStats.framesPresented++;
+  }
+}
+
+// Virtual time to clock a transfer of bytes plus the address byte.
+Micros busTime(size_t bytes) {
+  uint32_t clock = Wire1.clock() ? Wire1.clock() : 100000;
+  return ((bytes + 1) * 9 + 2) * 1000000ULL / clock + 1;
+}
+
+}  // namespace
+
+
+//    *** Runtime API ***
+
+void begin(uint32_t seed) {
+  randomState = seed ? seed : 1;
+  memset(&model, 0, sizeof(model));
+  model.page = 0xFF;
+  startCore(0, core0Entry);
+  startCore(1, core1Entry);
+  started = true;
+}
+
+void feedSerial(Micros at, const uint8_t *data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    serialInput.push_back({at, data[i]});
+  }
+  lastFeedArrival = at;
+}
+
+void run(Micros until) {
+  if (!started || stopped) return;
+  runUntil = until;
+  while (!stopped && cores[nextCore()].now < runUntil) {
+    current = nextCore();
+    swapcontext(&mainContext, &cores[current].context);
+  }
+  current = -1;
+}
+
+Micros now() {
+  return min(cores[0].now, cores[1].now);
+}
+
+Micros lastArrival() {
+  return lastFeedArrival;
+}
+
+bool rebooted() {
+  return stopped;
+}
+
+void onSerialOutput(std::function<void(Micros, uint8_t)> handler) {
+  serialOutputHandler = handler;
+}
+
+const std::vector<CommandRecord> &commands() {
+  return commandLog;
+}
+
+const I2CStats &i2c() {
+  return i2cStats;
+}
+
+const MatrixModel &matrix() {
+  return model;
+}
+
+// Used by the shim below, which lives outside the anonymous namespace.
+Micros coreNow() {
+  return cores[current].now;
+}
+
+void coreAdvance(Micros cost) {
+  advance(cost);
+}
+
+void coreStop() {
+  stopped = true;
+  advance(0);
+}
+
+int serialAvailable() {
+  int count = 0;
+  for (const SerialByte &byte : serialInput) {
+    if (byte.at > coreNow()) break;
+    count++;
+  }
+  return count;
+}
+
+int serialRead() {
+  if (serialInput.empty() || serialInput.front().at > coreNow()) {
+    return -1;
+  }
+  SerialByte byte = serialInput.front();
+  serialInput.pop_front();
+  lastReadArrival = byte.at;
+  return byte.value;
+}
+
+// Wait up to timeout for the next serial byte. Returns false on timeout.
+bool serialWait(Micros timeout) {
+  Micros deadline = coreNow() + timeout;
+  while (serialInput.empty() || serialInput.front().at > coreNow()) {
+    if (coreNow() >= deadline) return false;
+    Micros wake = deadline;
+    if (!serialInput.empty()) wake = min(wake, serialInput.front().at);
+    coreAdvance(max(wake - coreNow(), pollCost));
+  }
+  return true;
+}
+
+void serialWrite(uint8_t value) {
+  if (serialOutputHandler) serialOutputHandler(coreNow(), value);
+}
+
+void fifoPush(uint32_t value) {
+  while (fifo.size() >= fifoDepth) coreAdvance(pollCost);
+  fifo.push_back({value, lastReadArrival});
+  coreAdvance(pollCost);
+}
+
+bool fifoPushNonBlocking(uint32_t value) {
+  if (fifo.size() >= fifoDepth) return false;
+  fifo.push_back({value, lastReadArrival});
+  return true;
+}
+
+uint32_t fifoPop() {
+  while (fifo.empty()) coreAdvance(pollCost);
+  FifoEntry entry = fifo.front();
+  fifo.pop_front();
+
+  // The first pop of each loop1() pass on core 1 is the command opcode.
+  if (current == 1 && awaitingOpcode) {
+    awaitingOpcode = false;
+    commandLog.push_back({uint8_t(entry.value), entry.arrived, coreNow(), 0, 0});
+  }
+  return entry.value;
+}
+
+int fifoAvailable() {
+  return fifo.size();
+}
+
+void fifoClear() {
+  fifo.clear();
+}
+
+uint8_t i2cWrite(uint8_t address, const uint8_t *data, size_t length) {
+  Micros cost = busTime(length);
+  i2cStats.transactions++;
+  i2cStats.bytes += length + 1;
+  i2cStats.busyMicros += cost;
+  coreAdvance(cost);
+  if (address != modelAddress) return 2;
+  modelWrite(data, length);
+  return 0;
+}
+
+size_t i2cRead(uint8_t address, uint8_t *data, size_t length) {
+  Micros cost = busTime(length);
+  i2cStats.transactions++;
+  i2cStats.reads++;
+  i2cStats.bytes += length + 1;
+  i2cStats.busyMicros += cost;
+  coreAdvance(cost);
+  if (address != modelAddress || model.page > 4) return 0;
+  // Reads return the register last addressed by a write.
+  return length;
+}
+
+uint32_t nextRandom() {
+  // xorshift32, so traces replay identically on every host.
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+void reseed(uint32_t seed) {
+  randomState = seed ? seed : 1;
+}
+
+uint8_t lastRegister = 0;
+
+}  // namespace host
+
+
+//    *** Arduino API ***
+
+unsigned long millis() { return host::coreNow() / 1000; }
+unsigned long micros() { return host::coreNow(); }
+
+void delay(unsigned long ms) { host::coreAdvance(host::Micros(ms) * 1000); }
+void delayMicroseconds(unsigned int us) { host::coreAdvance(us); }
+void tight_loop_contents() { host::coreAdvance(host::pollCost); }
+void __wfe() { host::coreAdvance(host::pollCost); }
+void __sev() {}
+
+long random(long howbig) {
+  if (howbig <= 0) return 0;
+  return host::nextRandom() % howbig;
+}
+
+long random(long howsmall, long howbig) {
+  if (howsmall >= howbig) return howsmall;
+  return howsmall + random(howbig - howsmall);
+}
+
+void randomSeed(unsigned long seed) { host::reseed(seed); }
+
+void pinMode(uint8_t pin, uint8_t mode) { (void)pin; (void)mode; }
+void digitalWrite(uint8_t pin, uint8_t value) { (void)pin; (void)value; }
+int digitalRead(uint8_t pin) { (void)pin; return HIGH; }
+
+void rom_reset_usb_boot(uint32_t gpioMask, uint32_t disableInterfaceMask) {
+  (void)gpioMask;
+  (void)disableInterfaceMask;
+  host::coreStop();
+}
+
+int HostSerial::available() {
+  host::coreAdvance(0);
+  return host::serialAvailable();
+}
+
+int HostSerial::read() {
+  int value = host::serialRead();
+  if (value < 0) host::coreAdvance(host::pollCost);
+  return value;
+}
+
+size_t HostSerial::readBytes(uint8_t *buffer, size_t length) {
+  size_t count = 0;
+  while (count < length && host::serialWait(host::Micros(timeout_) * 1000)) {
+    buffer[count++] = host::serialRead();
+  }
+  return count;
+}
+
+size_t HostSerial::write(uint8_t value) {
+  host::serialWrite(value);
+  return 1;
+}
+
+size_t HostSerial::write(const uint8_t *buffer, size_t length) {
+  for (size_t i = 0; i < length; i++) host::serialWrite(buffer[i]);
+  return length;
+}
+
+void HostFifo::push(uint32_t value) { host::fifoPush(value); }
+bool HostFifo::push_nb(uint32_t value) { return host::fifoPushNonBlocking(value); }
+uint32_t HostFifo::pop() { return host::fifoPop(); }
+int HostFifo::available() { return host::fifoAvailable(); }
+void HostFifo::clear() { host::fifoClear(); }
+
+bool HostFifo::pop_nb(uint32_t *value) {
+  if (host::fifoAvailable() == 0) return false;
+  *value = host::fifoPop();
+  return true;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+  address_ = address;
+  length_ = 0;
+}
+
+size_t TwoWire::write(uint8_t value) {
+  if (length_ >= sizeof(buffer_)) return 0;
+  buffer_[length_++] = value;
+  return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+  (void)sendStop;
+  if (length_ > 0) host::lastRegister = buffer_[0];
+  return host::i2cWrite(address_, buffer_, length_);
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, size_t quantity, bool sendStop) {
+  (void)sendStop;
+  quantity = min(quantity, sizeof(response_));
+  responseLength_ = host::i2cRead(address, response_, quantity);
+  for (size_t i = 0; i < responseLength_; i++) {
+    response_[i] = host::matrix().registers[host::matrix().page][uint8_t(host::lastRegister + i)];
+  }
+  responseIndex_ = 0;
+  return responseLength_;
+}
+
+int TwoWire::available() {
+  return responseLength_ - responseIndex_;
+}
+
+int TwoWire::read() {
+  if (responseIndex_ >= responseLength_) return -1;
+  return response_[responseIndex_++];
+}
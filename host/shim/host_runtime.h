@@ -0,0 +1,84 @@
+/*
+  Written by sigroot (github.com/sigroot)
+
+  host_runtime.h - Deterministic host runtime for the LEDMatrix firmware.
+
+  Both rp2040 cores run as cooperative contexts on one thread. Each core has
+  its own virtual clock that advances only when it waits on serial, I2C, the
+  inter core FIFO or a delay, and the core that is furthest behind always
+  runs next. With a fixed random seed the same serial input always produces
+  the same I2C traffic.
+
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <vector>
+
+namespace host {
+
+// A time on the virtual clock in microseconds.
+typedef uint64_t Micros;
+
+// One command as seen by core 1.
+struct CommandRecord {
+  uint8_t opcode;
+  // When the opcode byte arrived on serial.
+  Micros arrived;
+  // When core 1 popped the opcode from the inter core FIFO.
+  Micros dispatched;
+  // When loop1() returned after running the command.
+  Micros completed;
+  // The full frames written to the matrix while the command ran.
+  uint32_t framesPresented;
+};
+
+// Totals of I2C traffic to the matrix controller.
+struct I2CStats {
+  uint64_t transactions;
+  uint64_t bytes;
+  uint64_t reads;
+  Micros busyMicros;
+  // Bulk writes to the second PWM page, which end every full frame upload.
+  uint64_t framesPresented;
+};
+
+// The register state of the IS31FL3741A model.
+struct MatrixModel {
+  uint8_t page;
+  bool unlocked;
+  uint32_t resets;
+  uint8_t registers[5][256];
+};
+
+// Seed the firmware's random() and reset the virtual clocks. Call once before
+// the first run().
+void begin(uint32_t seed);
+
+// Queue bytes that arrive on the module's serial port at a virtual time.
+void feedSerial(Micros at, const uint8_t *data, size_t length);
+
+// Run both cores until their clocks reach until.
+void run(Micros until);
+
+// The virtual time both cores have reached.
+Micros now();
+
+// The virtual time the last queued serial byte arrives.
+Micros lastArrival();
+
+// True once the firmware has jumped to the bootloader.
+bool rebooted();
+
+// Called with every byte the firmware writes to serial.
+void onSerialOutput(std::function<void(Micros, uint8_t)> handler);
+
+const std::vector<CommandRecord> &commands();
+const I2CStats &i2c();
+const MatrixModel &matrix();
+
+}  // namespace host
@@ -0,0 +1,102 @@
+/*
+  Written by sigroot (github.com/sigroot)
+
+  trace.cpp - Reading and writing of serial trace files.
+
+*/
+
+#include "trace.h"
+
+#include <string.h>
+
+namespace trace {
+
+Writer::~Writer() {
+  close();
+}
+
+bool Writer::open(const std::string &path) {
+  close();
+  file_ = fopen(path.c_str(), "wb");
+  if (!file_) return false;
+
+  uint8_t header[8] = {0};
+  memcpy(header, magic, sizeof(magic));
+  header[4] = version;
+  last_ = 0;
+  return fwrite(header, 1, sizeof(header), file_) == sizeof(header);
+}
+
+bool Writer::write(uint64_t at, Direction direction, const uint8_t *data, size_t length) {
+  if (!file_) return false;
+
+  // Records longer than the length field are split.
+  while (length > 0) {
+    size_t chunk = length > 0xFFFF ? 0xFFFF : length;
+    uint32_t delta = at - last_;
+    uint8_t header[7] = {
+      uint8_t(delta), uint8_t(delta >> 8), uint8_t(delta >> 16), uint8_t(delta >> 24),
+      uint8_t(chunk), uint8_t(chunk >> 8),
+      direction,
+    };
+    if (fwrite(header, 1, sizeof(header), file_) != sizeof(header)) return false;
+    if (fwrite(data, 1, chunk, file_) != chunk) return false;
+    last_ = at;
+    data += chunk;
+    length -= chunk;
+  }
+
+  // Keep the file usable if the recorder is killed.
+  fflush(file_);
+  return true;
+}
+
+void Writer::close() {
+  if (file_) fclose(file_);
+  file_ = nullptr;
+}
+
+bool read(const std::string &path, std::vector<Record> &records, std::string &error) {
+  FILE *file = fopen(path.c_str(), "rb");
+  if (!file) {
+    error = "can not open " + path;
+    return false;
+  }
+
+  uint8_t header[8];
+  if (fread(header, 1, sizeof(header), file) != sizeof(header) ||
+      memcmp(header, magic, sizeof(magic)) != 0) {
+    error = path + " is not a trace file";
+    fclose(file);
+    return false;
+  }
+  if (header[4] != version) {
+    error = path + " has unsupported trace version " + std::to_string(header[4]);
+    fclose(file);
+    return false;
+  }
+
+  uint64_t at = 0;
+  uint8_t recordHeader[7];
+  while (fread(recordHeader, 1, sizeof(recordHeader), file) == sizeof(recordHeader)) {
+    at += uint32_t(recordHeader[0]) | uint32_t(recordHeader[1]) << 8 |
+          uint32_t(recordHeader[2]) << 16 | uint32_t(recordHeader[3]) << 24;
+    size_t length = recordHeader[4] | recordHeader[5] << 8;
+
+    Record record;
+    record.at = at;
+    record.direction = Direction(recordHeader[6]);
+    record.data.resize(length);
+    if (fread(record.data.data(), 1, length, file) != length) {
+      error = path + " ends inside a record";
+      fclose(file);
+      return false;
+    }
+    records.push_back(std::move(record));
+  }
+
+  fclose(file);
+  return true;
+}
+
+}  // namespace trace
@@ -0,0 +1,56 @@
+/*
+  Written by sigroot (github.com/sigroot)
+
+  trace.h - Serial trace format for recording and replaying LEDMatrix traffic.
+
+  A trace file starts with the 4 byte magic "FWLT" and a version byte
+  followed by 3 reserved bytes. Each record after the header is:
+    4 bytes - microseconds since the previous record (little endian)
+    2 bytes - number of data bytes (little endian)
+    1 byte  - direction (0: host to module, 1: module to host)
+    n bytes - data exactly as it crossed the serial port
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+namespace trace {
+
+const char magic[4] = {'F', 'W', 'L', 'T'};
+const uint8_t version = 1;
+
+enum Direction : uint8_t {
+  toModule = 0,
+  toHost = 1,
+};
+
+struct Record {
+  // Microseconds since the start of the trace.
+  uint64_t at;
+  Direction direction;
+  std::vector<uint8_t> data;
+};
+
+// Appends records to a trace file as they happen.
+class Writer {
+ public:
+  ~Writer();
+  bool open(const std::string &path);
+  bool write(uint64_t at, Direction direction, const uint8_t *data, size_t length);
+  void close();
+
+ private:
+  FILE *file_ = nullptr;
+  uint64_t last_ = 0;
+};
+
+// Reads a whole trace file. Returns false and sets error if it is malformed.
+bool read(const std::string &path, std::vector<Record> &records, std::string &error);
+
+}  // namespace trace
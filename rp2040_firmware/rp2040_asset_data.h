@@ -0,0 +1,38 @@
+/*
+  Written by sigroot (github.com/sigroot)
+
+  rp2040_asset_data.h - Compressed images and animations of the LEDMatrix
+  input module, kept in flash.
+
+  Generated by host/fwasset from rp2040_firmware/assets with
+  `make -C host assets`. Do not edit by hand.
+
+*/
+
+//    *** Assets ***
+
+// gear: 4 frames, 1224 bytes uncompressed, 199 bytes compressed.
+const uint8_t gearAssetData[199] = {
+  0x3F, 0x2D, 0x84, 0x7F, 0x3F, 0x00, 0x3F, 0x7F, 0x02, 0x80, 0x3F, 0x44,
+  0x7F, 0x80, 0x3F, 0x01, 0x81, 0x7F, 0x7F, 0x02, 0x84, 0x7F, 0x7F, 0x00,
+  0x3F, 0x7F, 0x04, 0x83, 0x7F, 0x3F, 0x7F, 0x7F, 0x04, 0x83, 0x7F, 0x7F,
+  0x3F, 0x7F, 0x04, 0x84, 0x7F, 0x3F, 0x00, 0x7F, 0x7F, 0x02, 0x81, 0x7F,
+  0x7F, 0x01, 0x80, 0x3F, 0x44, 0x7F, 0x80, 0x3F, 0x02, 0x84, 0x7F, 0x3F,
+  0x00, 0x3F, 0x7F, 0x3F, 0x36, 0x3F, 0x2D, 0x84, 0x3F, 0x7F, 0x3F, 0x00,
+  0x3F, 0x02, 0x80, 0x00, 0x04, 0x82, 0x7F, 0x00, 0x3F, 0x06, 0x81, 0x3F,
+  0x7F, 0x06, 0x81, 0x00, 0x3F, 0x06, 0x81, 0x00, 0x00, 0x07, 0x80, 0x3F,
+  0x06, 0x81, 0x7F, 0x00, 0x45, 0x7F, 0x03, 0x83, 0x3F, 0x00, 0x7F, 0x3F,
+  0x7F, 0x00, 0x37, 0x3F, 0x2D, 0x83, 0x00, 0x3F, 0x7F, 0x3F, 0x43, 0x00,
+  0x80, 0x3F, 0x04, 0x81, 0x3F, 0x00, 0x42, 0x7F, 0x04, 0x81, 0x7F, 0x3F,
+  0x06, 0x81, 0x3F, 0x00, 0x07, 0x80, 0x3F, 0x07, 0x42, 0x7F, 0x06, 0x80,
+  0x3F, 0x08, 0x81, 0x00, 0x3F, 0x3F, 0x39, 0x3F, 0x2D, 0x84, 0x3F, 0x00,
+  0x3F, 0x7F, 0x3F, 0x02, 0x45, 0x7F, 0x82, 0x00, 0x00, 0x3F, 0x06, 0x81,
+  0x3F, 0x00, 0x06, 0x81, 0x7F, 0x3F, 0x06, 0x81, 0x3F, 0x7F, 0x06, 0x81,
+  0x00, 0x3F, 0x06, 0x82, 0x3F, 0x00, 0x00, 0x04, 0x80, 0x7F, 0x02, 0x84,
+  0x3F, 0x7F, 0x3F, 0x00, 0x3F, 0x3F, 0x36
+};
+const Asset gearAsset = { gearAssetData, sizeof(gearAssetData), 4 };
+
+// Every asset, for reporting.
+const Asset *const assetList[] = { &gearAsset };
+const uint8_t assetCount = 1;
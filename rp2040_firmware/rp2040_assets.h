@@ -0,0 +1,142 @@
+/*
+  Written by sigroot (github.com/sigroot)
+
+  rp2040_assets.h - Playback of the built-in images and animations of the
+  LEDMatrix input module.
+
+  Assets are compressed into const tables in flash by host/fwasset (see
+  rp2040_asset_data.h) and decoded one frame at a time, so only the frame
+  being shown takes RAM.
+
+*/
+
+#define SIG_ASSETS 1
+
+#if !(SIG_FIRMWARE)
+#include "rp2040_firmware.h"
+#endif
+
+//    *** Structs ***
+
+// A compressed image or animation in flash.
+struct Asset {
+  // The tokens of every frame, one after another (see host/fwasset.cpp).
+  const uint8_t *data;
+  uint16_t size;
+  uint8_t frameCount;
+};
+
+// Decodes the frames of an asset in order. Each frame is coded against the
+// one before it, so the decoded frame is kept to decode the next.
+struct AssetPlayer {
+  const Asset *asset;
+  // Where the tokens of the next frame start.
+  const uint8_t *next;
+  // The frame last decoded, or 0xFF before the first.
+  uint8_t index;
+  uint8_t frame[34][9];
+};
+
+
+#include "rp2040_asset_data.h"
+
+
+//    *** Global Variables ***
+
+// Plays the Framework gear for the startup animation and rotateGear. They
+// never run at the same time.
+AssetPlayer gearPlayer;
+
+// Statistics of every frame decoded. Read with the 'G' command.
+uint32_t assetDecodedFrames;
+uint32_t assetDecodeMicros;
+
+
+//    *** Functions ***
+
+// Decode the tokens of one frame over the previous frame. Returns a pointer
+// to the tokens of the following frame.
+const uint8_t *assetDecodeFrame(const uint8_t *data, uint8_t frame[LEDHeight][LEDWidth]) {
+  uint8_t *pixel = &frame[0][0];
+  uint8_t *end = pixel + LEDHeight*LEDWidth;
+
+  while (pixel < end) {
+    uint8_t token = *data++;
+    uint8_t count = (token & (token & 0x80 ? 0x7F : 0x3F)) + 1;
+    if (count > end - pixel) {
+      count = end - pixel;
+    }
+
+    if (token < 0x40) {
+      // Unchanged pixels.
+      pixel += count;
+    } else if (token < 0x80) {
+      // A run of one value.
+      memset(pixel, *data++, count);
+      pixel += count;
+    } else {
+      // Literal values.
+      memcpy(pixel, data, count);
+      data += count;
+      pixel += count;
+    }
+  }
+  return data;
+}
+
+// Start playing an asset from its first frame.
+void assetBegin(AssetPlayer &player, const Asset &asset) {
+  player.asset = &asset;
+  player.next = asset.data;
+  player.index = 0xFF;
+  memset(player.frame, 0, sizeof(player.frame));
+}
+
+// Returns a frame of the asset being played. Frames after the last decoded
+// one are decoded in order. Earlier frames restart from the first, so
+// looping animations should be played forwards.
+uint8_t (*assetFrame(AssetPlayer &player, uint8_t index))[LEDWidth] {
+  index %= player.asset->frameCount;
+  if (index == player.index) {
+    return player.frame;
+  }
+  if (player.index != 0xFF && index < player.index) {
+    assetBegin(player, *player.asset);
+  }
+
+  uint32_t startTime = micros();
+  while (player.index != index) {
+    player.next = assetDecodeFrame(player.next, player.frame);
+    player.index++;
+    assetDecodedFrames++;
+  }
+  assetDecodeMicros += micros() - startTime;
+
+  return player.frame;
+}
+
+// Print the flash and RAM used by assets against keeping every frame in RAM,
+// and the average time taken to decode a frame.
+void assetReport() {
+  uint32_t flashBytes = 0;
+  uint32_t rawBytes = 0;
+  for (int i = 0; i < assetCount; i++) {
+    flashBytes += assetList[i]->size;
+    rawBytes += assetList[i]->frameCount * sizeof(gearPlayer.frame);
+  }
+
+  Serial.print("ASSETS count=");
+  Serial.print(assetCount);
+  Serial.print(" raw_bytes=");
+  Serial.print(rawBytes);
+  Serial.print(" flash_bytes=");
+  Serial.print(flashBytes);
+  Serial.print(" ram_bytes=");
+  Serial.print(sizeof(gearPlayer));
+  Serial.print(" ram_saved_bytes=");
+  Serial.print(rawBytes - sizeof(gearPlayer));
+  Serial.print(" decoded_frames=");
+  Serial.print(assetDecodedFrames);
+  Serial.print(" decode_us=");
+  Serial.println(assetDecodeMicros / max(assetDecodedFrames, uint32_t(1)));
+}
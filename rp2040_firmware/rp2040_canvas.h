@@ -0,0 +1,258 @@
+/*
+  Written by sigroot (github.com/sigroot)
+
+  rp2040_canvas.h - A 1 bit per pixel canvas and monochrome drawing for the
+  LEDMatrix input module.
+
+  Each row of the canvas is one word with bit x holding column x, so most
+  drawing changes a whole row at once. Pixels only become PWM values while
+  they are uploaded to the matrix.
+
+*/
+
+#define SIG_CANVAS 1
+
+#if !(SIG_FIRMWARE)
+#include "rp2040_firmware.h"
+#endif
+
+//    *** Constants ***
+
+// The bits of a row that are on the matrix.
+const uint16_t canvasRowMask = 0x01FF;
+
+// The number of bytes of a packed frame: every pixel in reading order, 8 to a
+// byte with the first pixel in the highest bit.
+const uint8_t canvasPackedBytes = 39;
+
+// Drawing operations.
+//  0 - Turn pixels on
+//  1 - Turn pixels off
+//  2 - Flip pixels
+const uint8_t canvasSet = 0;
+const uint8_t canvasClear = 1;
+const uint8_t canvasXor = 2;
+
+// Set in the operation byte of the 'j' and 'J' commands to draw without
+// uploading, so several changes can be shown at once.
+const uint8_t canvasNoShow = 0x80;
+
+// Shapes drawn with the 'j' command.
+//  0 - Pixel at x0, y0
+//  1 - Line from x0, y0 to x1, y1
+//  2 - Filled rectangle with corners x0, y0 and x1, y1
+//  3 - Whole canvas
+const uint8_t canvasPixel = 0;
+const uint8_t canvasLine = 1;
+const uint8_t canvasRect = 2;
+const uint8_t canvasAll = 3;
+
+
+//    *** Global Variables ***
+
+// The canvas, one row per word.
+uint16_t canvasRows[34];
+
+// The PWM of off and on pixels.
+uint8_t canvasLevels[2] = { 0x00, 0xFF };
+
+// Packed frames read by core 0 for the 'l' command. Core 0 alternates between
+// them so it can read a frame while core 1 unpacks the last.
+uint8_t canvasPacked[2][39];
+uint8_t canvasPackedWrite;
+
+// The upload routine for the current transform, and the transform flags it
+// was chosen for.
+typedef uint8_t (*CanvasUpload)(uint8_t firstPage);
+CanvasUpload canvasUpload;
+uint8_t canvasUploadFlags = 0xFF;
+
+
+//    *** Upload ***
+
+// Reads each pixel of the canvas for uploadPixels as its PWM level, and
+// remembers it as displayed.
+struct CanvasSource {
+  uint8_t operator()(uint8_t x, uint8_t y) const {
+    uint8_t pwm = canvasLevels[(canvasRows[y] >> x) & 1];
+    displayedMatrix[y][x] = pwm;
+    return pwm;
+  }
+};
+
+template <uint8_t Flags>
+uint8_t uploadCanvas(uint8_t firstPage) {
+  return uploadPixels<Flags>(CanvasSource(), firstPage);
+}
+
+template <uint8_t Flags>
+struct CanvasUploadInstance {
+  static CanvasUpload get() { return uploadCanvas<Flags>; }
+};
+
+// Writes the canvas to the matrix LEDs' PWM.
+uint8_t writeCanvas() {
+  // Only look up the upload routine again when the transform has changed.
+  if (canvasUploadFlags != transformPWMFlags) {
+    canvasUpload = TransformLookup<CanvasUpload, CanvasUploadInstance>::find(transformPWMFlags);
+    canvasUploadFlags = transformPWMFlags;
+  }
+  return canvasUpload(PWMPage1);
+}
+
+
+//    *** Drawing ***
+
+// Apply an operation to the pixels of a row picked by a mask.
+void canvasApply(uint8_t y, uint16_t mask, uint8_t operation) {
+  switch (operation) {
+    case canvasSet:
+      canvasRows[y] |= mask;
+      break;
+    case canvasClear:
+      canvasRows[y] &= ~mask;
+      break;
+    case canvasXor:
+      canvasRows[y] ^= mask;
+      break;
+  }
+}
+
+// Apply an operation to one pixel. Pixels outside the canvas are ignored.
+void canvasDrawPixel(int x, int y, uint8_t operation) {
+  if (x < 0 || x >= LEDWidth || y < 0 || y >= LEDHeight) {
+    return;
+  }
+  canvasApply(y, 1 << x, operation);
+}
+
+// Apply an operation to every pixel of a filled rectangle. The corners may be
+// given in any order and are clipped to the canvas.
+void canvasDrawRect(int x0, int y0, int x1, int y1, uint8_t operation) {
+  int left = min(x0, x1);
+  int right = max(x0, x1);
+  int top = min(y0, y1);
+  int bottom = max(y0, y1);
+
+  // Rectangles entirely outside the canvas draw nothing.
+  if (right < 0 || left >= LEDWidth || bottom < 0 || top >= LEDHeight) {
+    return;
+  }
+  left = max(left, 0);
+  right = min(right, LEDWidth - 1);
+  top = max(top, 0);
+  bottom = min(bottom, LEDHeight - 1);
+
+  // Every column from left to right.
+  uint16_t mask = ((1 << (right + 1)) - 1) & ~((1 << left) - 1);
+  for (int y = top; y <= bottom; y++) {
+    canvasApply(y, mask, operation);
+  }
+}
+
+// Apply an operation to every pixel of a line using Bresenham's algorithm.
+void canvasDrawLine(int x0, int y0, int x1, int y1, uint8_t operation) {
+  int dx = abs(x1 - x0);
+  int dy = -abs(y1 - y0);
+  int stepX = x0 < x1 ? 1 : -1;
+  int stepY = y0 < y1 ? 1 : -1;
+  int error = dx + dy;
+
+  while (true) {
+    canvasDrawPixel(x0, y0, operation);
+    if (x0 == x1 && y0 == y1) break;
+
+    int doubled = 2*error;
+    if (doubled >= dy) {
+      error += dy;
+      x0 += stepX;
+    }
+    if (doubled <= dx) {
+      error += dx;
+      y0 += stepY;
+    }
+  }
+}
+
+// Move every pixel dx columns right (negative for left) and dy rows down
+// (negative for up). Pixels moved off one edge come back on the other if wrap
+// is set, otherwise they are lost and off pixels move in.
+void canvasShift(int dx, int dy, bool wrap) {
+  // Columns: shift every row word.
+  dx %= LEDWidth;
+  if (dx < 0) {
+    dx += wrap ? LEDWidth : 0;
+  }
+  for (int y = 0; y < LEDHeight; y++) {
+    uint16_t row = canvasRows[y];
+    if (wrap) {
+      row = (row << dx) | (row >> (LEDWidth - dx));
+    } else if (dx >= 0) {
+      row <<= dx;
+    } else {
+      row >>= -dx;
+    }
+    canvasRows[y] = row & canvasRowMask;
+  }
+
+  // Rows: move whole words.
+  dy %= LEDHeight;
+  if (dy == 0) {
+    return;
+  }
+  uint16_t shifted[34];
+  for (int y = 0; y < LEDHeight; y++) {
+    int from = y - dy;
+    if (wrap) {
+      from = (from + LEDHeight) % LEDHeight;
+    }
+    shifted[y] = (from >= 0 && from < LEDHeight) ? canvasRows[from] : 0;
+  }
+  memcpy(canvasRows, shifted, sizeof(canvasRows));
+}
+
+// Advance the canvas one generation of Conway's Game of Life. The canvas
+// wraps at its edges. Each row is computed at once by counting the 8
+// neighbours of every column in parallel with bitwise adders.
+void canvasLifeStep() {
+  uint16_t next[34];
+
+  for (int y = 0; y < LEDHeight; y++) {
+    uint16_t above = canvasRows[(y + LEDHeight - 1) % LEDHeight];
+    uint16_t row = canvasRows[y];
+    uint16_t below = canvasRows[(y + 1) % LEDHeight];
+
+    uint16_t neighbours[8] = {
+      above, below,
+      uint16_t((above << 1) | (above >> (LEDWidth - 1))), uint16_t((above >> 1) | (above << (LEDWidth - 1))),
+      uint16_t((row << 1) | (row >> (LEDWidth - 1))), uint16_t((row >> 1) | (row << (LEDWidth - 1))),
+      uint16_t((below << 1) | (below >> (LEDWidth - 1))), uint16_t((below >> 1) | (below << (LEDWidth - 1)))
+    };
+
+    // The count of live neighbours as bits 0, 1 and "4 or more".
+    uint16_t count0 = 0, count1 = 0, count4 = 0;
+    for (int i = 0; i < 8; i++) {
+      uint16_t carry0 = count0 & neighbours[i];
+      count0 ^= neighbours[i];
+      count4 |= count1 & carry0;
+      count1 ^= carry0;
+    }
+
+    // Alive with 3 neighbours, or alive already with 2.
+    next[y] = ~count4 & count1 & (count0 | row) & canvasRowMask;
+  }
+
+  memcpy(canvasRows, next, sizeof(canvasRows));
+}
+
+// Replace the canvas with a packed frame.
+void canvasUnpack(uint8_t packed[canvasPackedBytes]) {
+  uint16_t bit = 0;
+  for (int y = 0; y < LEDHeight; y++) {
+    uint16_t row = 0;
+    for (int x = 0; x < LEDWidth; x++, bit++) {
+      row |= ((packed[bit >> 3] >> (7 - (bit & 7))) & 1) << x;
+    }
+    canvasRows[y] = row;
+  }
+}
@@ -0,0 +1,231 @@
+/*
+  Written by sigroot (github.com/sigroot)
+
+  rp2040_commands.h - Descriptions of the serial commands of the LEDMatrix
+  input module.
+
+  Every command is described once, in the command table of
+  rp2040_firmware.ino. Core 0 reads each command's payload from its payload
+  bytes and length rule alone, and core 1 runs it from the same description,
+  so the serial length of a command can not disagree with the table or the
+  'C' report. The 'C' command prints the table so
+  host programs can check which commands a module supports.
+
+*/
+
+#define SIG_COMMANDS 1
+
+#if !(SIG_FIRMWARE)
+#include "rp2040_firmware.h"
+#endif
+
+//    *** Constants ***
+
+// How the length of a command's payload is found.
+//  0 - Fixed: payloadBytes bytes
+//  1 - Length prefixed: payloadBytes bytes, the last two of which are a 16
+//      bit big-endian count of the bytes that follow
+//  2 - Sample format: payloadBytes bytes, the first of which is a PCM format,
+//      then 64 samples of that format (2 bytes each for format 16, else 1)
+const uint8_t lengthFixed = 0;
+const uint8_t lengthPrefixed = 1;
+const uint8_t lengthSampleFormat = 2;
+
+// Flags of a command.
+//  0x01 - Sends its opcode back once done, for software blocking
+//  0x02 - Prints text
+//  0x04 - Runs for a while, and ends early when a new command arrives
+const uint8_t commandAcks = 0x01;
+const uint8_t commandReports = 0x02;
+const uint8_t commandPreemptible = 0x04;
+
+// The index of opcodes that are not commands.
+const uint8_t commandUnknown = 0xFF;
+
+// How long core 0 waits for the whole payload of a command, from its opcode.
+// A command unfinished by then is dropped, so a host that stopped part way
+// through a command gets back in step by sending nothing for this long.
+const uint32_t commandTimeoutMillis = 100;
+
+// The most payload bytes kept for one command: a 'u' header and a slice of
+// the whole virtual frame. Bytes past it are read and dropped.
+const uint16_t commandPayloadCapacity = 4 + viewportCapacity;
+
+
+//    *** Structs ***
+
+// A serial command.
+struct Command {
+  uint8_t opcode;
+  // The bytes after the opcode, and how to find the length of any more.
+  uint16_t payloadBytes;
+  uint8_t lengthRule;
+  uint8_t flags;
+  // The FIFO entries core 0 pushes after the opcode.
+  uint8_t fifoEntries;
+  // Pushes the FIFO entries of a payload read by core 0. If nullptr, each
+  // payload byte is pushed as one entry.
+  void (*ingest)(const uint8_t *payload);
+  // Runs the command on core 1 once its FIFO entries have arrived.
+  void (*run)();
+  // The name printed in errors.
+  const char *name;
+};
+
+// The table index of every opcode, or commandUnknown.
+struct CommandIndex {
+  uint8_t entry[256];
+};
+
+
+//    *** Global Variables ***
+
+// The payload of the command core 0 is reading.
+uint8_t commandPayload[commandPayloadCapacity];
+
+// The time core 0 spent reading the last payload from serial.
+uint32_t commandReadMicros;
+
+
+//    *** Table checks ***
+
+// Builds the index of a command table at compile time.
+template <size_t Count>
+constexpr CommandIndex commandIndex(const Command (&table)[Count]) {
+  CommandIndex index = {};
+  for (int i = 0; i < 256; i++) {
+    index.entry[i] = commandUnknown;
+  }
+  for (size_t i = 0; i < Count; i++) {
+    index.entry[table[i].opcode] = i;
+  }
+  return index;
+}
+
+// Returns true if no opcode is in a command table twice, every payload fits
+// commandPayload, and every command without an ingest function is fixed
+// length with one FIFO entry per byte.
+template <size_t Count>
+constexpr bool commandsValid(const Command (&table)[Count]) {
+  for (size_t i = 0; i < Count; i++) {
+    for (size_t j = i + 1; j < Count; j++) {
+      if (table[i].opcode == table[j].opcode) {
+        return false;
+      }
+    }
+    if (table[i].payloadBytes > commandPayloadCapacity || (table[i].lengthRule == lengthPrefixed && table[i].payloadBytes < 2)) {
+      return false;
+    }
+    if (!table[i].ingest && (table[i].lengthRule != lengthFixed || table[i].fifoEntries != table[i].payloadBytes)) {
+      return false;
+    }
+  }
+  return Count < commandUnknown;
+}
+
+
+//    *** Functions ***
+
+// Reads a byte from serial, waiting until commandTimeoutMillis after
+// startMillis for it to arrive. Returns -1 if no byte arrived in time.
+int serialReadBefore(uint32_t startMillis) {
+  while (!Serial.available()) {
+    if (millis() - startMillis >= commandTimeoutMillis) {
+      return -1;
+    }
+    tight_loop_contents();
+  }
+  return Serial.read();
+}
+
+// Read count bytes of a payload from serial into commandPayload, starting at
+// offset. Bytes past the end of commandPayload are dropped. Returns false if
+// the command's time ran out first.
+bool commandRead(uint32_t offset, uint32_t count, uint32_t startMillis) {
+  for (uint32_t i = offset; i < offset + count; i++) {
+    int value = serialReadBefore(startMillis);
+    if (value == -1) {
+      return false;
+    }
+    if (i < commandPayloadCapacity) {
+      commandPayload[i] = value;
+    }
+  }
+  return true;
+}
+
+// Read the payload of a command into commandPayload, finding its length from
+// the command's payload bytes and length rule. Runs on core 0 straight after
+// the opcode is read. Returns false, having reported it, if the payload did
+// not all arrive within commandTimeoutMillis.
+bool commandReadPayload(const Command &command) {
+  uint32_t startMillis = millis();
+  uint32_t startTime = micros();
+  bool complete = commandRead(0, command.payloadBytes, startMillis);
+
+  uint32_t more = 0;
+  if (command.lengthRule == lengthPrefixed) {
+    more = (commandPayload[command.payloadBytes - 2] << 8) | commandPayload[command.payloadBytes - 1];
+  } else if (command.lengthRule == lengthSampleFormat) {
+    more = visualizerSamples * visualizerSampleBytes(commandPayload[0]);
+  }
+  complete = complete && commandRead(command.payloadBytes, more, startMillis);
+  commandReadMicros = micros() - startTime;
+
+  if (!complete) {
+    Serial.print("ERROR: timed out reading ");
+    Serial.println(command.name);
+  }
+  return complete;
+}
+
+// Push the FIFO entries of a command's payload. Runs on core 0.
+void commandIngest(const Command &command) {
+  if (command.ingest) {
+    command.ingest(commandPayload);
+    return;
+  }
+  for (int i = 0; i < command.payloadBytes; i++) {
+    rp2040.fifo.push(commandPayload[i]);
+  }
+}
+
+// Run a command whose opcode has been popped. Runs on core 1.
+void commandRun(const Command &command) {
+  if (rp2040.fifo.available() < command.fifoEntries) {
+    Serial.print("ERROR: too few arguments for ");
+    Serial.println(command.name);
+    return;
+  }
+  command.run();
+}
+
+// Print every command of a table on one line, in table order, as
+// opcode:payload[:flags] with the opcode in hexadecimal. The payload is
+// followed by '+' if it is length prefixed or 's' if it is followed by a
+// block of samples. The flags are 'a' (acknowledges), 'r' (prints text) and
+// 'p' (preemptible).
+// e.g. "COMMANDS 00:0 4D:306:a 75:4+ 79:1s 7F:0:r"
+template <size_t Count>
+void commandReport(const Command (&table)[Count]) {
+  Serial.print("COMMANDS");
+  for (size_t i = 0; i < Count; i++) {
+    const Command &command = table[i];
+    Serial.print(command.opcode < 0x10 ? " 0" : " ");
+    Serial.print(command.opcode, HEX);
+    Serial.print(":");
+    Serial.print(command.payloadBytes);
+    if (command.lengthRule == lengthPrefixed) {
+      Serial.print("+");
+    } else if (command.lengthRule == lengthSampleFormat) {
+      Serial.print("s");
+    }
+    if (command.flags) {
+      Serial.print(":");
+      if (command.flags & commandAcks) Serial.print("a");
+      if (command.flags & commandReports) Serial.print("r");
+      if (command.flags & commandPreemptible) Serial.print("p");
+    }
+  }
+  Serial.println();
+}
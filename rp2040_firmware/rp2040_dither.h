@@ -0,0 +1,161 @@
+/*
+  Written by sigroot (github.com/sigroot)
+
+  rp2040_dither.h - Temporal dithering of high bit depth frames onto the
+  LEDMatrix input module.
+
+*/
+
+#define SIG_DITHER 1
+
+#if !(SIG_FIRMWARE)
+#include "rp2040_firmware.h"
+#endif
+
+//    *** Constants ***
+
+// A 4x4 ordered (Bayer) pattern. Each LED starts its dither cycle at a
+// different phase so neighbouring LEDs do not flicker in step.
+const uint8_t ditherPhase[4][4] = {
+  {  0,  8,  2, 10 },
+  { 12,  4, 14,  6 },
+  {  3, 11,  1,  9 },
+  { 15,  7, 13,  5 }
+};
+
+// The default number of extra bits of brightness produced by dithering.
+// Each extra bit doubles the number of refreshes in a dither cycle.
+const uint8_t ditherBitsDefault = 2;
+
+
+//    *** Global Variables ***
+
+// The 16 bit brightness of each LED as sent over serial by core 0. Core 0
+// alternates between the two so it can read a frame while core 1 loads the
+// last.
+uint16_t ditherMatrix[2][34][9];
+uint8_t ditherMatrixWrite;
+
+// The 16 bit brightness of each LED currently being dithered by core 1.
+uint16_t ditherLevels[34][9];
+
+// The brightness left over from previous refreshes of each LED.
+uint8_t ditherResidual[34][9];
+
+// The 8 bit PWM frame sent to the matrix on each refresh.
+uint8_t ditherOutput[34][9];
+
+// The number of extra bits of brightness currently being dithered (0-8).
+uint8_t ditherBits = ditherBitsDefault;
+
+// Statistics of the current dither run. Read with the 'H' command.
+uint32_t ditherStartMillis;
+uint32_t ditherEndMillis;
+uint32_t ditherRefreshCount;
+uint32_t ditherComputeMicros;
+uint32_t ditherUploadMicros;
+
+// The time core 0 spent reading the last high bit depth frame from serial.
+uint32_t ditherIngestMicros;
+
+
+//    *** Functions ***
+
+// Changes the curve of a 16 bit brightness to be more visible across its
+// entirety by the human eye. 16 bit counterpart of getGamma().
+uint16_t getGamma16(uint16_t level) {
+  return (uint32_t(level)*uint32_t(level)) >> 16;
+}
+
+// Reset the dither residuals to their ordered starting phases.
+void ditherResetResidual() {
+  for (int i = 0; i < LEDHeight; i++) {
+    for (int j = 0; j < LEDWidth; j++) {
+      ditherResidual[i][j] = ditherPhase[i & 3][j & 3] << 4;
+    }
+  }
+}
+
+// Copy a frame read by core 0 into the levels being dithered.
+// The low 4 bits of settings are the extra bits of brightness to dither
+// (0-8). The highest bit of settings enables gamma correction.
+void ditherLoad(uint8_t settings, uint16_t frame[LEDHeight][LEDWidth]) {
+  ditherBits = min(settings & 0x0F, 8);
+  bool useGamma = settings & 0x80;
+
+  for (int i = 0; i < LEDHeight; i++) {
+    for (int j = 0; j < LEDWidth; j++) {
+      if (useGamma) {
+        ditherLevels[i][j] = getGamma16(frame[i][j]);
+      } else {
+        ditherLevels[i][j] = frame[i][j];
+      }
+    }
+  }
+}
+
+// Compute the next refresh of the dithered frame into ditherOutput.
+// Each LED shows its 8 bit brightness plus one step whenever its running
+// residual overflows, so the time averaged brightness matches the 16 bit
+// level to within ditherBits extra bits.
+void ditherStep() {
+  // Only the fraction above the 8 bit value that fits in ditherBits is kept.
+  uint8_t fractionMask = ~(0xFF >> ditherBits);
+
+  for (int i = 0; i < LEDHeight; i++) {
+    for (int j = 0; j < LEDWidth; j++) {
+      uint16_t level = ditherLevels[i][j];
+      uint16_t sum = uint16_t(ditherResidual[i][j]) + (level & fractionMask);
+      uint16_t pwm = (level >> 8) + (sum >> 8);
+
+      ditherOutput[i][j] = min(pwm, uint16_t(255));
+      ditherResidual[i][j] = sum;
+    }
+  }
+}
+
+// Reset the statistics read with the 'H' command for a new dither run.
+void ditherBegin() {
+  ditherStartMillis = millis();
+  ditherRefreshCount = 0;
+  ditherComputeMicros = 0;
+  ditherUploadMicros = 0;
+}
+
+// Record when the dither run ended, so the 'H' report does not count the
+// time since.
+void ditherEnd() {
+  ditherEndMillis = millis();
+}
+
+// Compute and display one refresh of the dithered frame, timing both steps.
+void ditherRefresh() {
+  uint32_t computeStart = micros();
+  ditherStep();
+  uint32_t uploadStart = micros();
+  writeMatrix(ditherOutput);
+  uint32_t uploadEnd = micros();
+
+  ditherComputeMicros += uploadStart - computeStart;
+  ditherUploadMicros += uploadEnd - uploadStart;
+  ditherRefreshCount++;
+}
+
+// Print the refresh rate and per core cost of the last dither run.
+void ditherReport() {
+  uint32_t elapsed = max(ditherEndMillis - ditherStartMillis, uint32_t(1));
+  uint32_t refreshes = max(ditherRefreshCount, uint32_t(1));
+
+  Serial.print("DITHER refresh_hz=");
+  Serial.print(ditherRefreshCount * 1000 / elapsed);
+  Serial.print(" bits=");
+  Serial.print(ditherBits);
+  Serial.print(" core1_compute_us=");
+  Serial.print(ditherComputeMicros / refreshes);
+  Serial.print(" core1_upload_us=");
+  Serial.print(ditherUploadMicros / refreshes);
+  Serial.print(" core1_load_pct=");
+  Serial.print((ditherComputeMicros + ditherUploadMicros) / 10 / elapsed);
+  Serial.print(" core0_ingest_us=");
+  Serial.println(ditherIngestMicros);
+}
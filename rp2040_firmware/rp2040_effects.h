@@ -0,0 +1,193 @@
+/*
+  Written by sigroot (github.com/sigroot)
+
+  rp2040_effects.h - Cellular effects (fire, burn, rain and sparkle) the
+  LEDMatrix input module can display.
+
+*/
+
+#define SIG_EFFECTS 1
+
+#if !(SIG_FIRMWARE)
+#include "rp2040_firmware.h"
+#endif
+#if !(SIG_PATTERNS)
+#include "rp2040_patterns.h"
+#endif
+
+//    *** Structs ***
+
+// The rule used to compute each step of a cellular effect.
+// Every step, each cell takes the heat of the cell it moves from, blended
+// with that cell's left and right neighbours, keeps some of its own heat,
+// then cools by a random amount. New heat is then seeded.
+struct CellularEffect {
+  // Which way heat moves each step: -1 up, 1 down, 0 in place.
+  int8_t direction;
+  // Where new heat appears (see the seed constants below).
+  uint8_t seedMode;
+  // The largest amount a cell cools each step (0-255).
+  uint8_t cooling;
+  // How much heat is taken from the left and right neighbours (0-255).
+  uint8_t spread;
+  // The chance out of 255 that a seed cell is lit each step.
+  uint8_t seedChance;
+  // How much of a cell's own heat it keeps as a trail (0-255).
+  uint8_t trail;
+};
+
+
+//    *** Constants ***
+
+// Seed modes of a cellular effect.
+//  0 - No new heat
+//  1 - The bottom row
+//  2 - The top row
+//  3 - Any cell
+const uint8_t seedNone = 0;
+const uint8_t seedBottomRow = 1;
+const uint8_t seedTopRow = 2;
+const uint8_t seedAnywhere = 3;
+
+// Presets selected by number with the 'z' command.
+const CellularEffect effectPresets[4] = {
+  // Fire rising from the bottom row.
+  { -1, seedBottomRow, 120, 102, 255, 0 },
+  // Burn the displayed image away without adding heat.
+  { -1, seedNone, 120, 102, 0, 0 },
+  // Rain falling from the top row with fading trails.
+  { 1, seedTopRow, 40, 0, 24, 160 },
+  // Sparkles appearing anywhere and fading out.
+  { 0, seedAnywhere, 60, 0, 8, 0 }
+};
+const uint8_t firePreset = 0;
+const uint8_t burnPreset = 1;
+const uint8_t rainPreset = 2;
+const uint8_t sparklePreset = 3;
+
+// The column to the left and right of each column, wrapping around the edges.
+const uint8_t leftColumn[9] = { 8, 0, 1, 2, 3, 4, 5, 6, 7 };
+const uint8_t rightColumn[9] = { 1, 2, 3, 4, 5, 6, 7, 8, 0 };
+
+// Heat moving in from outside the matrix.
+const uint8_t coldRow[9] = { 0 };
+
+
+//    *** Global Variables ***
+
+// Two buffers of cell heat. Each step reads the front buffer and writes the
+// other, then they swap.
+uint8_t effectCells[2][34][9];
+uint8_t effectFront;
+
+// The rule of the running effect.
+CellularEffect effectSettings;
+
+// The state of the effect's random number generator.
+uint32_t effectRandomState;
+
+
+//    *** Functions ***
+
+// Returns the next 32 random bits of the effect's xorshift generator.
+uint32_t effectRandom() {
+  effectRandomState ^= effectRandomState << 13;
+  effectRandomState ^= effectRandomState >> 17;
+  effectRandomState ^= effectRandomState << 5;
+  return effectRandomState;
+}
+
+// Returns true with a chance out of 255 using one random byte.
+bool effectChance(uint8_t randomByte, uint8_t chance) {
+  return chance == 255 || randomByte < chance;
+}
+
+// Start an effect from the frame currently displayed. The same settings and
+// seed always produce the same frames.
+void effectBegin(CellularEffect settings, uint16_t seed) {
+  effectSettings = settings;
+
+  // The generator must not start at 0. Mix the seed so nearby seeds differ.
+  effectRandomState = (uint32_t(seed) * 0x9E3779B1u) | 1;
+  for (int i = 0; i < 4; i++) {
+    effectRandom();
+  }
+
+  effectFront = 0;
+  memcpy(effectCells[effectFront], displayedMatrix, sizeof(effectCells[effectFront]));
+
+  writeAllScale(defaultScale);
+}
+
+// Compute the next step of the running effect into the back buffer, then
+// make it the front buffer.
+void effectStep() {
+  uint8_t (*cells)[LEDWidth] = effectCells[effectFront];
+  uint8_t (*next)[LEDWidth] = effectCells[effectFront ^ 1];
+  const CellularEffect &settings = effectSettings;
+
+  // Weights of the cell moved from and of each of its neighbours (out of 256).
+  uint16_t sideWeight = settings.spread / 2;
+  uint16_t centreWeight = 256 - 2*sideWeight;
+
+  for (int i = 0; i < LEDHeight; i++) {
+    // The row heat moves in from, or a cold row past the edge of the matrix.
+    int source = i - settings.direction;
+    const uint8_t *from = (source >= 0 && source < LEDHeight) ? cells[source] : coldRow;
+
+    uint32_t noise = 0;
+    for (int j = 0; j < LEDWidth; j++) {
+      // Use each random word for 4 cells.
+      if ((j & 3) == 0) {
+        noise = effectRandom();
+      }
+
+      uint16_t heat = (from[j]*centreWeight + (from[leftColumn[j]] + from[rightColumn[j]])*sideWeight) >> 8;
+      uint16_t kept = (cells[i][j]*settings.trail) >> 8;
+      if (kept > heat) {
+        heat = kept;
+      }
+
+      uint8_t cooling = ((noise & 0xFF)*settings.cooling) >> 8;
+      noise >>= 8;
+      next[i][j] = heat > cooling ? heat - cooling : 0;
+    }
+  }
+
+  // Add new heat.
+  if (settings.seedMode == seedBottomRow || settings.seedMode == seedTopRow) {
+    uint8_t *row = next[settings.seedMode == seedBottomRow ? LEDHeight - 1 : 0];
+    uint32_t noise = 0;
+    for (int j = 0; j < LEDWidth; j++) {
+      if ((j & 1) == 0) {
+        noise = effectRandom();
+      }
+      if (effectChance(noise & 0xFF, settings.seedChance)) {
+        // Seeded heat flickers slightly.
+        row[j] = 255 - ((noise >> 8) & 0x3F);
+      }
+      noise >>= 16;
+    }
+  } else if (settings.seedMode == seedAnywhere) {
+    for (int i = 0; i < LEDHeight; i++) {
+      uint32_t noise = 0;
+      for (int j = 0; j < LEDWidth; j++) {
+        if ((j & 3) == 0) {
+          noise = effectRandom();
+        }
+        if (effectChance(noise & 0xFF, settings.seedChance)) {
+          next[i][j] = 255;
+        }
+        noise >>= 8;
+      }
+    }
+  }
+
+  effectFront ^= 1;
+}
+
+// Compute the next frame of the running effect into output.
+void effectFrame(uint8_t output[LEDHeight][LEDWidth]) {
+  effectStep();
+  memcpy(output, effectCells[effectFront], sizeof(effectCells[effectFront]));
+}
@@ -98,6 +98,9 @@ const uint8_t configRegister = 0x00;
 // Set the SSD bit to normal operation and the logic bit to high voltage.
 uint8_t configRegisterDefault = 0b00001001;
 
+// The SSD bit of the configuration register.
+const uint8_t configSSDBit = 0b00000001;
+
 // This page contains the first page of PWM registers:
 const uint8_t PWMPage1 = 0x00;
 
@@ -156,6 +159,25 @@ struct Result {
 //    ** Global Variables ***
 uint8_t currentPage = 0xFF;
 
+// The PWM value most recently written to each LED, in reading order.
+uint8_t displayedMatrix[34][9];
+
+// The scale value most recently written to each LED, in reading order, so the
+// scale can be moved again when the transform changes.
+uint8_t displayedScale[34][9];
+
+// The values last written to the PWM frequency and configuration registers,
+// so they can be restored without resetting the controller.
+uint8_t PWMRegisterValue;
+uint8_t configRegisterValue;
+
+// The brightness every PWM value is scaled by while the brightness transform
+// is on (255 is full brightness).
+uint8_t transformBrightness = 255;
+
+// The transform flags of PWM uploads, set by setTransform.
+uint8_t transformPWMFlags = 0;
+
 
 //    *** Functions ***
 
@@ -166,6 +188,119 @@ uint8_t getGamma(uint8_t pwm) {
 }
 
 
+//    *** Pixel transforms ***
+
+// Transform flags set with the 'o' command.
+// Mirroring both ways is the same as rotating 180 degrees.
+const uint8_t transformMirrorX = 0x01;
+const uint8_t transformMirrorY = 0x02;
+const uint8_t transformRotate180 = transformMirrorX | transformMirrorY;
+const uint8_t transformInvert = 0x04;
+// Flags only used to choose an upload routine.
+const uint8_t transformBrightnessScale = 0x08;
+const uint8_t transformGamma = 0x10;
+// Every combination of the transform flags.
+const uint8_t transformCombinations = 0x1F;
+
+// Each stage of a transform moves a pixel and/or changes its value. Stages
+// are chosen at compile time, so a stage that is not used costs nothing.
+struct NoStage {
+  static void position(uint8_t &x, uint8_t &y) {}
+  static uint8_t value(uint8_t value) { return value; }
+};
+
+struct MirrorXStage : NoStage {
+  static void position(uint8_t &x, uint8_t &y) { x = (LEDWidth-1) - x; }
+};
+
+struct MirrorYStage : NoStage {
+  static void position(uint8_t &x, uint8_t &y) { y = (LEDHeight-1) - y; }
+};
+
+struct InvertStage : NoStage {
+  static uint8_t value(uint8_t value) { return 255 - value; }
+};
+
+struct GammaStage : NoStage {
+  static uint8_t value(uint8_t value) { return getGamma(value); }
+};
+
+struct BrightnessStage : NoStage {
+  static uint8_t value(uint8_t value) { return (uint16_t(value) * (transformBrightness + 1)) >> 8; }
+};
+
+// A stage that is only part of the chain when Enabled is true.
+template <bool Enabled, class Stage>
+struct OptionalStage : Stage {};
+
+template <class Stage>
+struct OptionalStage<false, Stage> : NoStage {};
+
+// Stages applied one after another.
+template <class... Stages>
+struct TransformChain : NoStage {};
+
+template <class First, class... Rest>
+struct TransformChain<First, Rest...> {
+  static void position(uint8_t &x, uint8_t &y) {
+    First::position(x, y);
+    TransformChain<Rest...>::position(x, y);
+  }
+  static uint8_t value(uint8_t value) {
+    return TransformChain<Rest...>::value(First::value(value));
+  }
+};
+
+// The chain of stages for a combination of transform flags. The mirror
+// stages are their own inverse, so the same chain finds the LED a pixel is
+// shown on and the pixel an LED shows. Gamma comes first of the value
+// stages, so a frame uploaded with gamma shows the same as its corrected
+// values (kept in displayedMatrix) uploaded without it.
+template <uint8_t Flags>
+using PixelTransform = TransformChain<
+  OptionalStage<bool(Flags & transformMirrorX), MirrorXStage>,
+  OptionalStage<bool(Flags & transformMirrorY), MirrorYStage>,
+  OptionalStage<bool(Flags & transformGamma), GammaStage>,
+  OptionalStage<bool(Flags & transformInvert), InvertStage>,
+  OptionalStage<bool(Flags & transformBrightnessScale), BrightnessStage>>;
+
+// Move a pixel and change its value by a combination of transform flags.
+template <uint8_t Flags>
+void mapPixel(uint8_t &x, uint8_t &y, uint8_t &value) {
+  PixelTransform<Flags>::position(x, y);
+  value = PixelTransform<Flags>::value(value);
+}
+
+// Returns the instance of a template function for a combination of transform
+// flags known only at run time. Only used when the transform changes.
+template <class Function, template <uint8_t> class Instance, uint8_t Flags = transformCombinations>
+struct TransformLookup {
+  static Function find(uint8_t flags) {
+    if (flags == Flags) {
+      return Instance<Flags>::get();
+    }
+    return TransformLookup<Function, Instance, Flags - 1>::find(flags);
+  }
+};
+
+template <class Function, template <uint8_t> class Instance>
+struct TransformLookup<Function, Instance, 0> {
+  static Function find(uint8_t flags) {
+    return Instance<0>::get();
+  }
+};
+
+// Pixel mapping used by setPixel and setPixelScale. Chosen by setTransform.
+typedef void (*PixelMap)(uint8_t &x, uint8_t &y, uint8_t &value);
+PixelMap pixelMap = mapPixel<0>;
+PixelMap pixelScaleMap = mapPixel<0>;
+
+template <uint8_t Flags>
+struct PixelMapInstance {
+  static PixelMap get() { return mapPixel<Flags>; }
+};
+
+
 //  *** LED matrix command functions ***
 
 // Every time the command register is written to, it must be unlocked first.
@@ -275,62 +410,15 @@ uint8_t writeCommand(uint8_t page, uint8_t reg, uint8_t value){
   return max(pageErr, error);
 }
 
-// Set the PWM of each visible LED using the LED Matrix's Address Auto 
-// Increment mode.
-uint8_t writeAll(uint8_t value) {
-  // Switch to page 0
-  uint8_t pageErr1 = selectPage(0);
-
-  // Begin writing I2C message. 7 bits of LED Matrix controller address plus 0 for write bit.
-  Wire1.beginTransmission(LEDMatrixControllerAddress);
-
-  // Add the first register to the I2C message.
-  Wire1.write(0x00);
-
-  // Add the desired value for each register to the I2C message.
-  for (int i = 0; i <= 0xB3; i++) {
-    Wire1.write(value);
-  }
-
-  // Push the I2C message over wire. Can return an error code (non-zero is error).
-  uint8_t error1 = Wire1.endTransmission();
-
-  // Switch to page 1
-  uint8_t pageErr2 = selectPage(1);
-
-  // Begin writing I2C message. 7 bits of LED Matrix controller address plus 0 for write bit.
-  Wire1.beginTransmission(LEDMatrixControllerAddress);
-
-  // Add the first register to the I2C message.
-  Wire1.write(0x00);
-
-  // Add the desired value for each register to the I2C message.
-  for (int i = 0; i <= 0xAA; i++) {
-    // Skip unused LEDs
-    if (i >= 60 && i <= 89) {
-      Wire1.write(0);
-      continue;
-    }
-    if (i == 116 || i == 125 || i == 134 || i == 143 || i == 152) {
-      Wire1.write(0);
-      continue;
-    }
-    
-    Wire1.write(value);
-  }
-
-  // Push the I2C message over wire. Can return an error code (non-zero is error).
-  uint8_t error2 = Wire1.endTransmission();
-
-  // Return a non-zero error code if any operation had an error.
-  return max(pageErr1, max(pageErr2, max(error1, error2)));
-}
-
 // Set the Scale of each visible LED using the LED Matrix's Address Auto 
-// Increment mode.
+// Increment mode. Scale values are only ever moved by the transform, so
+// every LED gets the same scale whatever the transform.
 // *NOTE: excessive scale (LED current) may damage the LED Matrix (usually 
 // kept to 0x7F).
 uint8_t writeAllScale(uint8_t value) {
+  // Remember what is being displayed.
+  memset(displayedScale, value, sizeof(displayedScale));
+
   // Switch to page 0
   uint8_t pageErr1 = selectPage(2);
 
@@ -379,11 +467,22 @@ uint8_t writeAllScale(uint8_t value) {
   return max(pageErr1, max(pageErr2, max(error1, error2)));
 }
 
-// Writes pwm values to each LED matching the values of an inputted matrix by 
-// using the LED Matrix's Address Auto Increment mode.
-uint8_t writeMatrix(uint8_t inputMatrix[LEDHeight][LEDWidth], bool useGamma = false) {
-  // Switch to page 0
-  uint8_t pageErr1 = selectPage(0);
+// Reads each pixel of an inputted matrix for uploadPixels.
+struct MatrixSource {
+  uint8_t (*matrix)[LEDWidth];
+  uint8_t operator()(uint8_t x, uint8_t y) const { return matrix[y][x]; }
+};
+
+// Writes values to each LED of a pair of pages (0 and 1 for PWM, 2 and 3 for
+// scale) matching the pixels read from a source by using the LED Matrix's
+// Address Auto Increment mode. Each LED shows the pixel, and value, given by
+// a combination of transform flags. Each pixel is read exactly once.
+template <uint8_t Flags, class Source>
+uint8_t uploadPixels(const Source &source, uint8_t firstPage) {
+  typedef PixelTransform<Flags> Transform;
+
+  // Switch to the first page
+  uint8_t pageErr1 = selectPage(firstPage);
 
   // Begin writing I2C message. 7 bits of LED Matrix controller address plus 0 for write bit.
   Wire1.beginTransmission(LEDMatrixControllerAddress);
@@ -395,18 +494,15 @@ uint8_t writeMatrix(uint8_t inputMatrix[LEDHeight][LEDWidth], bool useGamma = fa
   for (int i = 0; i <= 0xB3; i++) {
     uint8_t x = (LEDWidth-1)-i/30;
     uint8_t y = i%30;
-    if (useGamma) {
-      Wire1.write(getGamma(inputMatrix[y][x]));
-    } else {
-      Wire1.write(inputMatrix[y][x]);
-    }
+    Transform::position(x, y);
+    Wire1.write(Transform::value(source(x, y)));
   }
 
   // Push the I2C message over wire. Can return an error code (non-zero is error).
   uint8_t error1 = Wire1.endTransmission();
 
-  // Switch to page 1
-  uint8_t pageErr2 = selectPage(1);
+  // Switch to the second page
+  uint8_t pageErr2 = selectPage(firstPage + 1);
 
   // Begin writing I2C message. 7 bits of LED Matrix controller address plus 0 for write bit.
   Wire1.beginTransmission(LEDMatrixControllerAddress);
@@ -450,11 +546,8 @@ uint8_t writeMatrix(uint8_t inputMatrix[LEDHeight][LEDWidth], bool useGamma = fa
         y = (((i-90) / 9) * 4 + 2) + (((i-90) % 9) - 5);
       }
     }
-    if (useGamma) {
-      Wire1.write(getGamma(inputMatrix[y][x]));
-    }else {
-      Wire1.write(inputMatrix[y][x]);
-    }
+    Transform::position(x, y);
+    Wire1.write(Transform::value(source(x, y)));
   }
 
   // Push the I2C message over wire. Can return an error code (non-zero is error).
@@ -464,89 +557,113 @@ uint8_t writeMatrix(uint8_t inputMatrix[LEDHeight][LEDWidth], bool useGamma = fa
   return max(pageErr1, max(pageErr2, max(error1, error2)));
 }
 
-// Writes scale values to each LED matching the values of an inputted matrix by 
-// using the LED Matrix's Address Auto Increment mode.
-uint8_t writeMatrixScale(uint8_t inputMatrix[LEDHeight][LEDWidth], bool useGamma = false) {
-  // Switch to page 2
-  uint8_t pageErr1 = selectPage(2);
+// Reads the same value for every pixel for uploadPixels.
+struct ConstantSource {
+  uint8_t value;
+  uint8_t operator()(uint8_t x, uint8_t y) const { return value; }
+};
 
-  // Begin writing I2C message. 7 bits of LED Matrix controller address plus 0 for write bit.
-  Wire1.beginTransmission(LEDMatrixControllerAddress);
+// Writes values to each LED of a pair of pages matching the values of an
+// inputted matrix.
+template <uint8_t Flags>
+uint8_t uploadMatrix(uint8_t inputMatrix[LEDHeight][LEDWidth], uint8_t firstPage) {
+  return uploadPixels<Flags>(MatrixSource{inputMatrix}, firstPage);
+}
 
-  // Add the first register to the I2C message.
-  Wire1.write(0x00);
+// Upload routines used by writeMatrix and writeMatrixScale, with and without
+// gamma correction. Chosen by setTransform so that changing the transform
+// swaps which routine runs instead of testing it at every LED.
+typedef uint8_t (*MatrixUpload)(uint8_t inputMatrix[LEDHeight][LEDWidth], uint8_t firstPage);
+MatrixUpload pwmUpload[2] = { uploadMatrix<0>, uploadMatrix<transformGamma> };
+MatrixUpload scaleUpload[2] = { uploadMatrix<0>, uploadMatrix<transformGamma> };
 
-  // Add the desired value for each register from the matrix to the I2C message.
-  for (int i = 0; i <= 0xB3; i++) {
-    uint8_t x = (LEDWidth-1)-i/30;
-    uint8_t y = i%30;
-    if (useGamma) {
-      Wire1.write(getGamma(inputMatrix[y][x]));
-    } else {
-      Wire1.write(inputMatrix[y][x]);
-    }
-  }
+template <uint8_t Flags>
+struct MatrixUploadInstance {
+  static MatrixUpload get() { return uploadMatrix<Flags>; }
+};
 
-  // Push the I2C message over wire. Can return an error code (non-zero is error).
-  uint8_t error1 = Wire1.endTransmission();
+// Writes one value to each LED of a pair of pages.
+template <uint8_t Flags>
+uint8_t uploadConstant(uint8_t value, uint8_t firstPage) {
+  return uploadPixels<Flags>(ConstantSource{value}, firstPage);
+}
 
-  // Switch to page 3
-  uint8_t pageErr2 = selectPage(3);
+// Upload routine used by writeAll. Chosen by setTransform.
+typedef uint8_t (*ConstantUpload)(uint8_t value, uint8_t firstPage);
+ConstantUpload pwmConstantUpload = uploadConstant<0>;
 
-  // Begin writing I2C message. 7 bits of LED Matrix controller address plus 0 for write bit.
-  Wire1.beginTransmission(LEDMatrixControllerAddress);
+template <uint8_t Flags>
+struct ConstantUploadInstance {
+  static ConstantUpload get() { return uploadConstant<Flags>; }
+};
 
-  // Add the first register to the I2C message.
-  Wire1.write(0x00);
+// Set the PWM of each visible LED, changed by the current transform, using
+// the LED Matrix's Address Auto Increment mode.
+uint8_t writeAll(uint8_t value) {
+  // Remember what is being displayed.
+  memset(displayedMatrix, value, sizeof(displayedMatrix));
 
-  // Add the desired value for each register from the matrix to the I2C message.
-  for (int i = 0; i <= 0xA0; i++) {
-    uint8_t x;
-    uint8_t y;
+  return pwmConstantUpload(value, 0);
+}
 
-    // Translate the current LED number to x and y coordinates
-    if (i <= 59) {
-      x = 2-i/30;
-      y = i%30;
-    } 
-    // Skip unused LEDs
-    else if (i <= 89 || i == 116 || i == 125 || i == 134 || i == 143 || i == 152) {
-      Wire1.write(0);
-      continue;
-    } 
-    // Write bottom rows of LEDs (highest 4 y values)
-    else if ((i-90) % 9 <= 3) {
-      x = (LEDWidth-1) - (i-90) / 9;
-      y = (i-90) % 9 + 30;
-    } 
-    // Write left most column of LEDs
-    else if (i <= 107) {
-      x = 0;
-      if ((i-90) % 9 == 4) {
-        y = ((i-90) / 9) * 5 + 4;
+// Writes pwm values to each LED matching the values of an inputted matrix by 
+// using the LED Matrix's Address Auto Increment mode.
+uint8_t writeMatrix(uint8_t inputMatrix[LEDHeight][LEDWidth], bool useGamma = false) {
+  // Remember what is being displayed.
+  for (int i = 0; i < LEDHeight; i++) {
+    for (int j = 0; j < LEDWidth; j++) {
+      if (useGamma) {
+        displayedMatrix[i][j] = getGamma(inputMatrix[i][j]);
       } else {
-        y = ((i-90) / 9) * 5 + (((i-90) % 9) - 5);
+        displayedMatrix[i][j] = inputMatrix[i][j];
       }
-    } else {
-      x = 0;
-      if ((i-90) % 9 == 4) {
-        y = ((i-90) / 9 + 1) * 4 + 1;
+    }
+  }
+
+  return pwmUpload[useGamma](inputMatrix, 0);
+}
+
+// Writes scale values to each LED matching the values of an inputted matrix by 
+// using the LED Matrix's Address Auto Increment mode.
+uint8_t writeMatrixScale(uint8_t inputMatrix[LEDHeight][LEDWidth], bool useGamma = false) {
+  // Remember what is being displayed.
+  for (int i = 0; i < LEDHeight; i++) {
+    for (int j = 0; j < LEDWidth; j++) {
+      if (useGamma) {
+        displayedScale[i][j] = getGamma(inputMatrix[i][j]);
       } else {
-        y = (((i-90) / 9) * 4 + 2) + (((i-90) % 9) - 5);
+        displayedScale[i][j] = inputMatrix[i][j];
       }
     }
-    if (useGamma) {
-      Wire1.write(getGamma(inputMatrix[y][x]));
-    }else {
-      Wire1.write(inputMatrix[y][x]);
-    }
   }
 
-  // Push the I2C message over wire. Can return an error code (non-zero is error).
-  uint8_t error2 = Wire1.endTransmission();
+  return scaleUpload[useGamma](inputMatrix, 2);
+}
 
-  // Return a non-zero error code if any operation had an error.
-  return max(pageErr1, max(pageErr2, max(error1, error2)));
+// Set how images and pixels are moved and changed on their way to the matrix
+// using the transform flags. Brightness scales every PWM value (255 is full
+// brightness). Scale values are only ever moved, never inverted or dimmed.
+// Nothing is rewritten; redraw displayedMatrix and displayedScale to show
+// the new transform.
+void setTransform(uint8_t flags, uint8_t brightness) {
+  uint8_t position = flags & (transformMirrorX | transformMirrorY);
+  uint8_t pwm = flags & (transformMirrorX | transformMirrorY | transformInvert);
+  if (brightness != 255) {
+    pwm |= transformBrightnessScale;
+  }
+  transformBrightness = brightness;
+  transformPWMFlags = pwm;
+
+  typedef TransformLookup<MatrixUpload, MatrixUploadInstance> findUpload;
+  pwmUpload[0] = findUpload::find(pwm);
+  pwmUpload[1] = findUpload::find(pwm | transformGamma);
+  scaleUpload[0] = findUpload::find(position);
+  scaleUpload[1] = findUpload::find(position | transformGamma);
+  pwmConstantUpload = TransformLookup<ConstantUpload, ConstantUploadInstance>::find(pwm);
+
+  typedef TransformLookup<PixelMap, PixelMapInstance> findPixelMap;
+  pixelMap = findPixelMap::find(pwm);
+  pixelScaleMap = findPixelMap::find(position);
 }
 
 // Set the PWM frequency setting register.
@@ -556,6 +673,7 @@ uint8_t setPWMFrequencyRegister(uint8_t value) {
   //  0000 [always]
   //  0000 [PFS - set PWM frequency setting to 29kHz]
   //  )
+  PWMRegisterValue = value;
   return writeCommand(functionPage, PWMRegister, value);
 }
 
@@ -595,6 +713,7 @@ uint8_t setConfigurationRegister(uint8_t value) {
   //  00 [OSDE - Disable open and short detection] 
   //  1 [SSD - Set to normal operation]
   //  )
+  configRegisterValue = value;
   return writeCommand(functionPage, configRegister, value);
 }
 
@@ -627,10 +746,16 @@ uint8_t setPixel(uint8_t x, uint8_t y, uint8_t pwm) {
   uint8_t LEDNumber, page;
 
   // Coordinate outside of range
-  if (x < 0 || x > LEDWidth || y < 0 || y > LEDHeight) {
+  if (x >= LEDWidth || y >= LEDHeight) {
     return 1;
   }
 
+  // Remember what is being displayed.
+  displayedMatrix[y][x] = pwm;
+
+  // Move the pixel and change its value by the current transform.
+  pixelMap(x, y, pwm);
+
   // Write if the coordinate is on page 0
   if (x >= 3 && y <=29) {
     LEDNumber = 30*(8-x) + y;
@@ -674,10 +799,16 @@ uint8_t setPixelScale(uint8_t x, uint8_t y, uint8_t scale) {
   uint8_t LEDNumber, page;
 
   // Coordinate outside of range
-  if (x < 0 || x > LEDWidth || y < 0 || y > LEDHeight) {
+  if (x >= LEDWidth || y >= LEDHeight) {
     return 1;
   }
 
+  // Remember what is being displayed.
+  displayedScale[y][x] = scale;
+
+  // Move the pixel by the current transform.
+  pixelScaleMap(x, y, scale);
+
   // Write if the coordinate is on page 0
   if (x >= 3 && y <=29) {
     LEDNumber = 30*(8-x) + y;
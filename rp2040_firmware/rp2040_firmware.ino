@@ -11,6 +11,36 @@
 #if !(SIG_PATTERNS)
 #include "rp2040_patterns.h"
 #endif
+#if !(SIG_DITHER)
+#include "rp2040_dither.h"
+#endif
+#if !(SIG_TRANSITIONS)
+#include "rp2040_transitions.h"
+#endif
+#if !(SIG_EFFECTS)
+#include "rp2040_effects.h"
+#endif
+#if !(SIG_PIPELINE)
+#include "rp2040_pipeline.h"
+#endif
+#if !(SIG_VISUALIZER)
+#include "rp2040_visualizer.h"
+#endif
+#if !(SIG_CANVAS)
+#include "rp2040_canvas.h"
+#endif
+#if !(SIG_ASSETS)
+#include "rp2040_assets.h"
+#endif
+#if !(SIG_VIEWPORT)
+#include "rp2040_viewport.h"
+#endif
+#if !(SIG_IDLE)
+#include "rp2040_idle.h"
+#endif
+#if !(SIG_COMMANDS)
+#include "rp2040_commands.h"
+#endif
 
 
 //    *** Constants ***
@@ -25,103 +55,100 @@ const int bootTime = 10000;
 
 //    *** Global variables ***
 int autoBootTimer;
-bool newCommand;
+// Set by core 0 once a command is pushed and cleared by core 1 as it starts
+// the command. Volatile so every wait on it rereads it.
+volatile bool newCommand;
+
+// Frames read from serial by core 0. Core 0 alternates between them so that
+// it can read the next frame while core 1 is still writing the last one.
+uint8_t serialFrames[2][34][9];
+uint8_t serialFrameWrite;
 
 
 //    *** Functions ***
 
+// Waits for a free frame of the pipeline to render into.
+// Returns nullptr instead if newCommand is set.
+uint8_t (*pipelineAcquire())[LEDWidth] {
+  uint32_t startTime = micros();
+  while (pipelineFull() && !newCommand) {
+    tight_loop_contents();
+  }
+  pipelineWaitMicros += micros() - startTime;
+
+  if (newCommand) return nullptr;
+  return pipelineBack();
+}
+
+// Waits for core 0 to send or drop every queued frame, after which core 1
+// may use I2C again, and records when the pipeline run ended.
+void pipelineEnd() {
+  while (!pipelineEmpty()) {
+    tight_loop_contents();
+  }
+  pipelineEndMillis = millis();
+}
+
 // Displays a neat animation inteded for startup.
 // Can be interrupted if newCommand is set.
 void startupAnimation() {
+  assetBegin(gearPlayer, gearAsset);
 
-  while (!newCommand) {
-    
-    for (int f = 0; f < 80; f++) {
-      if (newCommand) break;
-
-      // Draw background of animation.
-      for (int i = 0; i < LEDHeight; i++) {
-        if (newCommand) break;
-        for (int j = 0; j < LEDWidth; j++) {
-          if (newCommand) break;
-          // writes a neat moving pattern.
-          inputMatrix[i][j] = 60*cos(2*PI*(0.5*double(i*17%LEDHeight)/LEDHeight + 0.5*double(j*13%LEDWidth)/LEDWidth - double(f)/80))
-                              + 80*sin(2*PI*(0.5*double(i)/LEDHeight + 0.5*double(j)/LEDWidth - double(f)/80)) + 60;
-        }
-      }
-      
-      // Add Framework gear.
-      for (int i = 0; i < LEDHeight; i++) {
-        if (newCommand) break;
-        for (int j = 0; j < LEDWidth; j++) {
-          if (newCommand) break;
-          inputMatrix[i][j] = (uint16_t(inputMatrix[i][j]) + uint16_t(FWGear[f/20][i][j]))/2;
-        }
-      }
-
-      // Display matrix.
-      writeMatrix(inputMatrix, true);
+  pipelineBegin();
+  for (int f = 0; !newCommand; f = (f + 1) % 80) {
+    uint8_t (*frame)[LEDWidth] = pipelineAcquire();
+    if (!frame) break;
 
-      // Remove Framework gear.
-      for (int i = 0; i < LEDHeight; i++) {
-        if (newCommand) break;
-        for (int j = 0; j < LEDWidth; j++) {
-          if (newCommand) break;
-          inputMatrix[i][j] = (2*uint16_t(inputMatrix[i][j]) - uint16_t(FWGear[f/20][i][j]));
-        }
-      }
-    }
+    startupFrame(f, assetFrame(gearPlayer, f/20), frame);
+    pipelineSubmit(true);
   }
+  pipelineEnd();
 }
 
 // Displays a neat animation inteded for startup for a short time.
-// Can not be interrupted if newCommand is set.
+// Can be interrupted if newCommand is set.
 void singleStartupAnimation() {
-  for (int k = 0; k < 4; k++){
-    for (int f = 0; f < 80; f++) {
-
-      // Draw background of animation.
-      for (int i = 0; i < LEDHeight; i++) {
-        if (newCommand) break;
-        for (int j = 0; j < LEDWidth; j++) {
-          if (newCommand) break;
-          // writes a neat moving pattern.
-          inputMatrix[i][j] = 60*cos(2*PI*(0.5*double(i*17%LEDHeight)/LEDHeight + 0.5*double(j*13%LEDWidth)/LEDWidth - double(f)/80))
-                              + 80*sin(2*PI*(0.5*double(i)/LEDHeight + 0.5*double(j)/LEDWidth - double(f)/80)) + 60;
-        }
-      }
-      
-      // Add Framework gear.
-      for (int i = 0; i < LEDHeight; i++) {
-        if (newCommand) break;
-        for (int j = 0; j < LEDWidth; j++) {
-          if (newCommand) break;
-          inputMatrix[i][j] = (uint16_t(inputMatrix[i][j]) + uint16_t(FWGear[f/20][i][j]))/2;
-        }
-      }
+  assetBegin(gearPlayer, gearAsset);
 
-      // Display matrix.
-      writeMatrix(inputMatrix, true);
+  pipelineBegin();
+  for (int f = 0; f < 4*80; f++) {
+    uint8_t (*frame)[LEDWidth] = pipelineAcquire();
+    if (!frame) break;
 
-      // Remove Framework gear.
-      for (int i = 0; i < LEDHeight; i++) {
-        if (newCommand) break;
-        for (int j = 0; j < LEDWidth; j++) {
-          if (newCommand) break;
-          inputMatrix[i][j] = (2*uint16_t(inputMatrix[i][j]) - uint16_t(FWGear[f/20][i][j]));
-        }
-      }
+    startupFrame(f % 80, assetFrame(gearPlayer, (f % 80)/20), frame);
+    pipelineSubmit(true);
+  }
+  pipelineEnd();
+}
+
+// Displays the running cellular effect at a given framerate (0 for as fast
+// as possible) for a number of frames (0 for until a new command is sent).
+// Can be interrupted if newCommand is set.
+void effectPattern(uint8_t fps, uint16_t frames) {
+  int frameDelay = fps ? 1000/fps : 0;
+
+  pipelineBegin();
+  for (uint16_t i = 0; frames == 0 || i < frames; i++) {
+    int startTime = millis();
+
+    uint8_t (*frame)[LEDWidth] = pipelineAcquire();
+    if (!frame) break;
+    effectFrame(frame);
+    pipelineSubmit();
+
+    // Spin until frame rate is reached
+    while (millis() - startTime < frameDelay && !newCommand) {
+      delay(1);
     }
   }
+  pipelineEnd();
 }
 
 // Turns previous matrix into fire.
 // Can be interrupted if newCommand is set.
 void burnPattern() {
-  for(int i = 0; i < 100; i++) {
-    if (newCommand == true) break;
-    burn();
-  }
+  effectBegin(effectPresets[burnPreset], micros());
+  effectPattern(0, 100);
 }
 
 // Closes the connections and returns to the bootloader
@@ -134,83 +161,181 @@ void endFirmware() {
 
 //Displays a fire pattern until a new command is sent.
 void fireplacePattern() {
-  while (!newCommand) {
-    fireplace();
-  }
+  effectBegin(effectPresets[firePreset], micros());
+  effectPattern(0, 0);
 }
 
 // Displays a rotating ring.
 // Can be interrupted if newCommand is set.
 void ringPattern(uint8_t fps) {
-  int frameDelay = 1000/fps;
+  int frameDelay = fps ? 1000/fps : 0;
+  writeAllScale(defaultScale);
 
+  pipelineBegin();
   for(int i = 0; !newCommand; i += 5) {
-    if (newCommand == true) break;
-
     int timeStart = millis();
 
-    spinningRing(i);
+    uint8_t (*frame)[LEDWidth] = pipelineAcquire();
+    if (!frame) break;
+    spinningRing(i, frame);
+    pipelineSubmit();
 
     // Spin until frame rate is reached
-    while (millis() - timeStart < frameDelay) {
+    while (millis() - timeStart < frameDelay && !newCommand) {
       delay(1);
     }
   }
+  pipelineEnd();
 }
 
 // Displays each frame of the spinning framework gear in order.
 // Can be interrupted if newCommand is set.
 void rotateGear(uint8_t fps) {
-  int frameDelay = 1000/fps;
-  while (!newCommand) {
-    for (int j = 0; j < 4; j++) {
-      if (newCommand) break;
+  int frameDelay = fps ? 1000/fps : 0;
+  assetBegin(gearPlayer, gearAsset);
 
-      int startTime = millis();
+  pipelineBegin();
+  for (int j = 0; !newCommand; j = (j + 1) % gearAsset.frameCount) {
+    int startTime = millis();
 
-      writeMatrix(FWGear[j]);
+    uint8_t (*frame)[LEDWidth] = pipelineAcquire();
+    if (!frame) break;
+    memcpy(frame, assetFrame(gearPlayer, j), sizeof(gearPlayer.frame));
+    pipelineSubmit();
 
-      // Spin until frame rate is reached
-      while (startTime - millis() < frameDelay) {
-        delay(1);
-      }
+    // Spin until frame rate is reached
+    while (millis() - startTime < frameDelay && !newCommand) {
+      delay(1);
     }
   }
+  pipelineEnd();
 }
 
 // Displays a neat diamond pattern.
 // Can be interrupted if newCommand is set.
 void diamondPattern(uint8_t fps) {
-  int frameDelay = 1000/fps;
+  int frameDelay = fps ? 1000/fps : 0;
+  writeAllScale(defaultScale);
+
+  pipelineBegin();
   for(int i = 0; i <= 255; i += 1) {
-    if (newCommand == true) break;
+    int startTime = millis();
+
+    uint8_t (*frame)[LEDWidth] = pipelineAcquire();
+    if (!frame) break;
+    diamonds(i, frame);
+    pipelineSubmit();
+
+    // Spin until frame rate is reached
+    while (millis() - startTime < frameDelay && !newCommand) {
+      delay(1);
+    }
+  }
+  pipelineEnd();
+}
+
+// Dithers a high bit depth frame onto the matrix until a new command is
+// sent.
+void ditherPattern(uint8_t settings, uint16_t frame[LEDHeight][LEDWidth]) {
+  ditherLoad(settings, frame);
+  ditherBegin();
+  while (!newCommand) {
+    ditherRefresh();
+  }
+  ditherEnd();
+}
+
+// Displays the prepared transition over duration milliseconds, ending on
+// its last frame.
+// Can be interrupted if newCommand is set.
+void transitionPattern(uint16_t duration, uint8_t curve) {
+  uint32_t startTime = millis();
+
+  pipelineBegin();
+  while (true) {
+    uint8_t (*frame)[LEDWidth] = pipelineAcquire();
+    if (!frame) break;
+    bool finished = transitionFrame(millis() - startTime, duration, curve, frame);
+    pipelineSubmit();
+    if (finished) break;
+  }
+  pipelineEnd();
+}
+
+// Steps the canvas through Conway's Game of Life at a given framerate (0 for
+// as fast as possible) for a number of generations (0 for until a new
+// command is sent).
+// Can be interrupted if newCommand is set.
+void lifePattern(uint8_t fps, uint8_t generations) {
+  int frameDelay = fps ? 1000/fps : 0;
+
+  for (int i = 0; generations == 0 || i < generations; i++) {
+    if (newCommand) break;
 
     int startTime = millis();
 
-    diamonds(i);
+    canvasLifeStep();
+    writeCanvas();
 
     // Spin until frame rate is reached
-    while (millis() - startTime < frameDelay) {
+    while (millis() - startTime < frameDelay && !newCommand) {
       delay(1);
     }
   }
 }
 
+// Scrolls the viewport across the virtual frame at a speed in columns and rows
+// per second (negative for left and up), showing each step as it is reached.
+// Can be interrupted if newCommand is set.
+void scrollPattern(int8_t columnsPerSecond, int8_t rowsPerSecond) {
+  uint32_t startTime = millis();
+  int32_t startX = viewportX;
+  int32_t startY = viewportY;
+  writeViewport();
+
+  while (!newCommand && (columnsPerSecond || rowsPerSecond)) {
+    int64_t elapsed = millis() - startTime;
+    uint16_t lastX = viewportX;
+    uint16_t lastY = viewportY;
+    viewportMove(startX + columnsPerSecond*elapsed/1000, startY + rowsPerSecond*elapsed/1000);
+
+    // Only upload when the viewport has moved a whole pixel.
+    if (viewportX != lastX || viewportY != lastY) {
+      writeViewport();
+    } else {
+      delay(1);
+    }
+  }
+}
+
+// Copies a full matrix read from serial into the serial frame core 1 is not
+// using, then sends its number to core 1.
+void serialLoadFrame(const uint8_t *payload) {
+  memcpy(serialFrames[serialFrameWrite], payload, sizeof(serialFrames[0]));
+  rp2040.fifo.push(serialFrameWrite);
+  serialFrameWrite ^= 1;
+}
+
+// Returns the serial frame numbered by the next FIFO entry.
+uint8_t (*serialFrame())[LEDWidth] {
+  return serialFrames[rp2040.fifo.pop() & 1];
+}
+
 // Writes PWM code to the matrix.
 // Core 0 wrote the matrix for communication.
 // Can be interrupted if newCommand is set.
-void serialWriteMatrix(bool useGamma = false) {
+void serialWriteMatrix(uint8_t frame[LEDHeight][LEDWidth], bool useGamma = false) {
   if (!newCommand) {
-    writeMatrix(inputMatrix, useGamma);
+    writeMatrix(frame, useGamma);
   }
 }
 
 // Writes PWM code to the matrix, then sends a serial response for blocking.
 // Core 0 wrote the matrix for communication.
 // Can be interrupted if newCommand is set.
-void serialWriteMatrixBlocking(bool useGamma = false) {
+void serialWriteMatrixBlocking(uint8_t frame[LEDHeight][LEDWidth], bool useGamma = false) {
   if (!newCommand) {
-    writeMatrix(inputMatrix, useGamma);
+    writeMatrix(frame, useGamma);
   }
   Serial.write('M');
 }
@@ -218,18 +343,18 @@ void serialWriteMatrixBlocking(bool useGamma = false) {
 // Writes scale code to the matrix.
 // Core 0 wrote the matrix for communication.
 // Can be interrupted if newCommand is set.
-void serialWriteMatrixScale(bool useGamma = false) {
+void serialWriteMatrixScale(uint8_t frame[LEDHeight][LEDWidth], bool useGamma = false) {
   if (!newCommand) {
-    writeMatrixScale(inputMatrix, useGamma);
+    writeMatrixScale(frame, useGamma);
   }
 }
 
 // Writes scale code to the matrix, then sends a serial response for blocking.
 // Core 0 wrote the matrix for communication.
 // Can be interrupted if newCommand is set.
-void serialWriteMatrixScaleBlocking(bool useGamma = false) {
+void serialWriteMatrixScaleBlocking(uint8_t frame[LEDHeight][LEDWidth], bool useGamma = false) {
   if (!newCommand) {
-    writeMatrixScale(inputMatrix, useGamma);
+    writeMatrixScale(frame, useGamma);
   }
   Serial.write('N');
 }
@@ -258,6 +383,443 @@ void testAllPixel() {
   }
 }
 
+//    *** Command ingest ***
+// Run on core 0 to push the FIFO entries of a payload read from serial, for
+// commands that are not simply one entry per byte.
+
+// Accept dither settings and full matrix of 16 bit brightness for dithering.
+// The matrix goes to the dither frame core 1 is not using and its number is
+// sent to core 1.
+void ingestDither(const uint8_t *payload) {
+  rp2040.fifo.push(payload[0]);
+  ditherIngestMicros = commandReadMicros;
+  const uint8_t *brightness = payload + 1;
+  for (int i = 0; i < LEDHeight; i++) {
+    for (int j = 0; j < LEDWidth; j++) {
+      ditherMatrix[ditherMatrixWrite][i][j] = (brightness[0] << 8) | brightness[1];
+      brightness += 2;
+    }
+  }
+  rp2040.fifo.push(ditherMatrixWrite);
+  ditherMatrixWrite ^= 1;
+}
+
+// Accept duration, easing curve and full matrix of pwm for a transition.
+void ingestTransition(const uint8_t *payload) {
+  for (int i = 0; i < 3; i++) {
+    rp2040.fifo.push(payload[i]);
+  }
+  serialLoadFrame(payload + 3);
+}
+
+// Accept slot and full matrix of pwm for storing a frame.
+void ingestStoreFrame(const uint8_t *payload) {
+  rp2040.fifo.push(payload[0]);
+  serialLoadFrame(payload + 1);
+}
+
+// Accept on and off PWM and a packed frame for the canvas. The frame goes to
+// the packed frame core 1 is not using and its number is sent to core 1.
+void ingestCanvasPacked(const uint8_t *payload) {
+  for (int i = 0; i < 2; i++) {
+    rp2040.fifo.push(payload[i]);
+  }
+  memcpy(canvasPacked[canvasPackedWrite], payload + 2, canvasPackedBytes);
+  rp2040.fifo.push(canvasPackedWrite);
+  canvasPackedWrite ^= 1;
+}
+
+// Accept offset, length and a slice of the virtual frame. The slice goes to
+// the slice buffer core 1 is not using, and the offset and length are packed
+// into one FIFO entry before its number.
+void ingestViewportSlice(const uint8_t *payload) {
+  uint16_t offset = (payload[0] << 8) | payload[1];
+  uint16_t length = (payload[2] << 8) | payload[3];
+  memcpy(viewportSlices[viewportSliceWrite], payload + 4, min(length, viewportCapacity));
+  rp2040.fifo.push((uint32_t(offset) << 16) | length);
+  rp2040.fifo.push(viewportSliceWrite);
+  viewportSliceWrite ^= 1;
+}
+
+// Accept 9 band levels for the visualizer. The levels are packed 4 to a FIFO
+// entry.
+void ingestVisualizerLevels(const uint8_t *payload) {
+  for (int i = 0; i < visualizerBands; i += 4) {
+    uint32_t packed = 0;
+    for (int j = i; j < i + 4 && j < visualizerBands; j++) {
+      packed |= uint32_t(payload[j]) << (8*(j - i));
+    }
+    rp2040.fifo.push(packed);
+  }
+}
+
+// Accept a PCM format and block of samples for the visualizer. The samples go
+// to the PCM buffer core 1 is not using and its number is sent to core 1.
+void ingestVisualizerPCM(const uint8_t *payload) {
+  uint8_t format = payload[0];
+  const uint8_t *sample = payload + 1;
+  for (int i = 0; i < visualizerSamples; i++) {
+    uint16_t raw = sample[0];
+    if (visualizerSampleBytes(format) == 2) {
+      raw = (raw << 8) | sample[1];
+    }
+    sample += visualizerSampleBytes(format);
+    visualizerPCM[visualizerPCMWrite][i] = visualizerSample(format, raw);
+  }
+  rp2040.fifo.push(format);
+  rp2040.fifo.push(visualizerPCMWrite);
+  visualizerPCMWrite ^= 1;
+}
+
+// Accept preset, cooling, spread, seed chance, fps and random seed for a
+// cellular effect. The 16 bit random seed is sent as one FIFO entry.
+void ingestEffect(const uint8_t *payload) {
+  for (int i = 0; i < 5; i++) {
+    rp2040.fifo.push(payload[i]);
+  }
+  rp2040.fifo.push((payload[5] << 8) | payload[6]);
+}
+
+
+//    *** Command handlers ***
+// Run on core 1 once every FIFO entry of the command has arrived. Arguments
+// are popped in the order they were sent.
+
+// No op
+void runNothing() {}
+
+// Run the startup animation once.
+void runSingleStartup() {
+  singleStartupAnimation();
+  writeAll(0);
+}
+
+// Clear the intercore fifo queue.
+void runClear() {
+  rp2040.fifo.clear();
+}
+
+// Run the diamond pattern with serial arguments.
+void runDiamond() {
+  diamondPattern(rp2040.fifo.pop());
+}
+
+// Display the Framwork gear spinning at a given framerate.
+void runGear() {
+  rotateGear(rp2040.fifo.pop());
+}
+
+// Dither the 16 bit matrix from the serial port until interrupted.
+void runDither() {
+  uint8_t settings = rp2040.fifo.pop();
+  ditherPattern(settings, ditherMatrix[rp2040.fifo.pop() & 1]);
+}
+
+// Transition from the displayed frame to the frame from the serial port.
+void runTransition() {
+  uint16_t duration = rp2040.fifo.pop() << 8;
+  duration |= rp2040.fifo.pop();
+  uint8_t curve = rp2040.fifo.pop();
+  transitionBegin(displayedMatrix, serialFrame());
+  transitionPattern(duration, curve);
+}
+
+// Store the frame from the serial port in a slot.
+void runStoreFrame() {
+  uint8_t slot = rp2040.fifo.pop();
+  if (storeFrameSlot(slot, serialFrame())) {
+    Serial.println("ERROR: invalid slot for storeFrameSlot");
+  }
+}
+
+// Draw a shape on the canvas, then display it.
+void runCanvasDraw() {
+  uint8_t operation = rp2040.fifo.pop();
+  uint8_t shape = rp2040.fifo.pop();
+  int8_t x0 = rp2040.fifo.pop();
+  int8_t y0 = rp2040.fifo.pop();
+  int8_t x1 = rp2040.fifo.pop();
+  int8_t y1 = rp2040.fifo.pop();
+  switch (shape) {
+    case canvasPixel:
+      canvasDrawPixel(x0, y0, operation & ~canvasNoShow);
+      break;
+    case canvasLine:
+      canvasDrawLine(x0, y0, x1, y1, operation & ~canvasNoShow);
+      break;
+    case canvasRect:
+      canvasDrawRect(x0, y0, x1, y1, operation & ~canvasNoShow);
+      break;
+    case canvasAll:
+      canvasDrawRect(0, 0, LEDWidth - 1, LEDHeight - 1, operation & ~canvasNoShow);
+      break;
+    default:
+      Serial.println("ERROR: invalid shape for canvasDraw");
+  }
+  if (!(operation & canvasNoShow)) {
+    writeCanvas();
+  }
+}
+
+// Shift the canvas, then display it.
+void runCanvasShift() {
+  int8_t dx = rp2040.fifo.pop();
+  int8_t dy = rp2040.fifo.pop();
+  uint8_t flags = rp2040.fifo.pop();
+  canvasShift(dx, dy, flags & 1);
+  if (!(flags & canvasNoShow)) {
+    writeCanvas();
+  }
+}
+
+// Replace the canvas with the packed frame from the serial port, then display
+// it.
+void runCanvasUnpack() {
+  canvasLevels[1] = rp2040.fifo.pop();
+  canvasLevels[0] = rp2040.fifo.pop();
+  canvasUnpack(canvasPacked[rp2040.fifo.pop() & 1]);
+  writeCanvas();
+}
+
+// Run the Game of Life on the canvas.
+void runLife() {
+  uint8_t fps = rp2040.fifo.pop();
+  lifePattern(fps, rp2040.fifo.pop());
+}
+
+// Write the entire matrix PWM from the serial port.
+void runWriteMatrix() {
+  serialWriteMatrix(serialFrame());
+}
+
+// Write the entire matrix PWM from the serial port, then send a response for
+// blocking.
+void runWriteMatrixBlocking() {
+  serialWriteMatrixBlocking(serialFrame());
+}
+
+// Write the entire matrix scale from the serial port.
+void runWriteMatrixScale() {
+  serialWriteMatrixScale(serialFrame());
+}
+
+// Write the entire matrix scale from the serial port, then send a response
+// for blocking.
+void runWriteMatrixScaleBlocking() {
+  serialWriteMatrixScaleBlocking(serialFrame());
+}
+
+// Set the orientation, inversion and brightness of everything displayed, then
+// redraw the displayed image with them. The scale is only redrawn if it has
+// moved.
+void runTransform() {
+  uint8_t mirror = transformMirrorX | transformMirrorY;
+  uint8_t lastPosition = transformPWMFlags & mirror;
+  uint8_t flags = rp2040.fifo.pop();
+  setTransform(flags, rp2040.fifo.pop());
+  writeMatrix(displayedMatrix);
+  if ((transformPWMFlags & mirror) != lastPosition) {
+    writeMatrixScale(displayedScale);
+  }
+}
+
+// Set a given pixel's PWM using serial arguments.
+void runPixel() {
+  uint8_t x = rp2040.fifo.pop();
+  uint8_t y = rp2040.fifo.pop();
+  setPixel(x, y, rp2040.fifo.pop());
+}
+
+// Set a given pixel's Scale using serial arguments.
+void runPixelScale() {
+  uint8_t x = rp2040.fifo.pop();
+  uint8_t y = rp2040.fifo.pop();
+  setPixelScale(x, y, rp2040.fifo.pop());
+}
+
+// Display the ring with an fps from serial arguments.
+void runRing() {
+  ringPattern(rp2040.fifo.pop());
+}
+
+// Set the scale of every LED.
+void runScale() {
+  writeAllScale(rp2040.fifo.pop());
+}
+
+// Set the PWM of every LED.
+void runPWM() {
+  writeAll(rp2040.fifo.pop());
+}
+
+// Scroll the viewport across the virtual frame.
+void runScroll() {
+  int8_t columnsPerSecond = rp2040.fifo.pop();
+  int8_t rowsPerSecond = rp2040.fifo.pop();
+  scrollPattern(columnsPerSecond, rowsPerSecond);
+}
+
+// Resize and clear the virtual frame.
+void runViewportResize() {
+  uint16_t width = rp2040.fifo.pop();
+  uint16_t height = rp2040.fifo.pop() << 8;
+  height |= rp2040.fifo.pop();
+  if (viewportResize(width, height)) {
+    Serial.println("ERROR: invalid size for viewportResize");
+  }
+}
+
+// Copy a slice of the virtual frame from the serial port into the frame.
+void runViewportSlice() {
+  uint32_t packed = rp2040.fifo.pop();
+  uint8_t *slice = viewportSlices[rp2040.fifo.pop() & 1];
+  uint16_t offset = packed >> 16;
+  uint16_t length = packed & 0xFFFF;
+  if (uint32_t(offset) + length > uint32_t(viewportWidth) * viewportHeight) {
+    Serial.println("ERROR: slice past the end of the virtual frame");
+    return;
+  }
+  memcpy(viewportFrame + offset, slice, length);
+}
+
+// Move the viewport, then display it.
+void runViewportMove() {
+  uint16_t x = rp2040.fifo.pop() << 8;
+  x |= rp2040.fifo.pop();
+  uint16_t y = rp2040.fifo.pop() << 8;
+  y |= rp2040.fifo.pop();
+  viewportMove(x, y);
+  writeViewport();
+}
+
+// Display visualizer bars from 9 band levels.
+void runVisualizerLevels() {
+  uint8_t levels[visualizerBands];
+  for (int i = 0; i < visualizerBands; i += 4) {
+    uint32_t packed = rp2040.fifo.pop();
+    for (int j = i; j < i + 4 && j < visualizerBands; j++) {
+      levels[j] = packed >> (8*(j - i));
+    }
+  }
+  visualizerShowLevels(levels);
+}
+
+// Crossfade between two stored frames.
+void runCrossfade() {
+  uint8_t (*from)[LEDWidth] = getFrameSlot(rp2040.fifo.pop());
+  uint8_t (*to)[LEDWidth] = getFrameSlot(rp2040.fifo.pop());
+  uint16_t duration = rp2040.fifo.pop() << 8;
+  duration |= rp2040.fifo.pop();
+  uint8_t curve = rp2040.fifo.pop();
+  if (from && to) {
+    transitionBegin(from, to);
+    transitionPattern(duration, curve);
+  } else {
+    Serial.println("ERROR: invalid slot for crossfadePattern");
+  }
+}
+
+// Display visualizer bars from a block of PCM samples.
+void runVisualizerPCM() {
+  uint8_t format = rp2040.fifo.pop();
+  uint8_t buffer = rp2040.fifo.pop();
+  if (format == 8 || format == 16) {
+    visualizerShowPCM(visualizerPCM[buffer]);
+  } else {
+    Serial.println("ERROR: invalid format for visualizerShowPCM");
+  }
+}
+
+// Display a cellular effect with settings from serial arguments.
+void runEffect() {
+  uint8_t preset = rp2040.fifo.pop();
+  CellularEffect settings = effectPresets[preset < 4 ? preset : firePreset];
+  settings.cooling = rp2040.fifo.pop();
+  settings.spread = rp2040.fifo.pop();
+  settings.seedChance = rp2040.fifo.pop();
+  uint8_t fps = rp2040.fifo.pop();
+  effectBegin(settings, rp2040.fifo.pop());
+  effectPattern(fps, 0);
+}
+
+// Set when to idle.
+void runIdleSettings() {
+  uint16_t timeout = rp2040.fifo.pop() << 8;
+  timeout |= rp2040.fifo.pop();
+  idleTimeoutMillis = timeout * 1000UL;
+  idleFlags = rp2040.fifo.pop();
+}
+
+// Print a known statement to confirm this firmware.
+void runVersion() {
+  Serial.print(versionStatement);
+}
+
+// Print the command table.
+void runCommandReport();
+
+
+//    *** Command table ***
+// Every serial command, in the order of the README. Core 0 reads each
+// command's payload and core 1 runs it from its entry here, and 'C' prints
+// the table for host programs.
+
+constexpr Command commandTable[] = {
+  // opcode, payload bytes, length rule, flags, FIFO entries, ingest, run, name
+  {0,   0,   lengthFixed,        0,                  0, nullptr,                runNothing,                  "noOp"},
+  {'a', 0,   lengthFixed,        commandPreemptible, 0, nullptr,                startupAnimation,            "startupAnimation"},
+  {'A', 0,   lengthFixed,        commandPreemptible, 0, nullptr,                runSingleStartup,            "singleStartupAnimation"},
+  {'b', 0,   lengthFixed,        commandPreemptible, 0, nullptr,                burnPattern,                 "burnPattern"},
+  {'c', 0,   lengthFixed,        0,                  0, nullptr,                runClear,                    "clearFIFO"},
+  {'C', 0,   lengthFixed,        commandReports,     0, nullptr,                runCommandReport,            "commandReport"},
+  {'d', 1,   lengthFixed,        commandPreemptible, 1, nullptr,                runDiamond,                  "diamondPattern"},
+  {'e', 0,   lengthFixed,        0,                  0, nullptr,                endFirmware,                 "endFirmware"},
+  {'f', 0,   lengthFixed,        commandPreemptible, 0, nullptr,                fireplacePattern,            "fireplacePattern"},
+  {'g', 1,   lengthFixed,        commandPreemptible, 1, nullptr,                runGear,                     "rotateGear"},
+  {'G', 0,   lengthFixed,        commandReports,     0, nullptr,                assetReport,                 "assetReport"},
+  {'h', 613, lengthFixed,        commandPreemptible, 2, ingestDither,           runDither,                   "ditherPattern"},
+  {'H', 0,   lengthFixed,        commandReports,     0, nullptr,                ditherReport,                "ditherReport"},
+  {'i', 309, lengthFixed,        commandPreemptible, 4, ingestTransition,       runTransition,               "transitionPattern"},
+  {'I', 3,   lengthFixed,        0,                  3, nullptr,                runIdleSettings,             "idleSettings"},
+  {'j', 6,   lengthFixed,        0,                  6, nullptr,                runCanvasDraw,               "canvasDraw"},
+  {'J', 3,   lengthFixed,        0,                  3, nullptr,                runCanvasShift,              "canvasShift"},
+  {'k', 307, lengthFixed,        0,                  2, ingestStoreFrame,       runStoreFrame,               "storeFrameSlot"},
+  {'l', 41,  lengthFixed,        0,                  3, ingestCanvasPacked,     runCanvasUnpack,             "canvasUnpack"},
+  {'L', 2,   lengthFixed,        commandPreemptible, 2, nullptr,                runLife,                     "lifePattern"},
+  {'m', 306, lengthFixed,        0,                  1, serialLoadFrame,        runWriteMatrix,              "serialWriteMatrix"},
+  {'M', 306, lengthFixed,        commandAcks,        1, serialLoadFrame,        runWriteMatrixBlocking,      "serialWriteMatrixBlocking"},
+  {'n', 306, lengthFixed,        0,                  1, serialLoadFrame,        runWriteMatrixScale,         "serialWriteMatrixScale"},
+  {'N', 306, lengthFixed,        commandAcks,        1, serialLoadFrame,        runWriteMatrixScaleBlocking, "serialWriteMatrixScaleBlocking"},
+  {'o', 2,   lengthFixed,        0,                  2, nullptr,                runTransform,                "setTransform"},
+  {'p', 3,   lengthFixed,        0,                  3, nullptr,                runPixel,                    "setPixel"},
+  {'P', 0,   lengthFixed,        commandReports,     0, nullptr,                pipelineReport,              "pipelineReport"},
+  {'q', 3,   lengthFixed,        0,                  3, nullptr,                runPixelScale,               "setPixelScale"},
+  {'r', 1,   lengthFixed,        commandPreemptible, 1, nullptr,                runRing,                     "ringPattern"},
+  {'s', 1,   lengthFixed,        0,                  1, nullptr,                runScale,                    "writeAllScale"},
+  {'S', 2,   lengthFixed,        commandPreemptible, 2, nullptr,                runScroll,                   "scrollPattern"},
+  {'t', 0,   lengthFixed,        commandReports | commandPreemptible, 0, nullptr,                testAllPixel,                "testAllPixel"},
+  {'u', 4,   lengthPrefixed,     0,                  2, ingestViewportSlice,    runViewportSlice,            "viewportSlice"},
+  {'U', 3,   lengthFixed,        0,                  3, nullptr,                runViewportResize,           "viewportResize"},
+  {'v', 9,   lengthFixed,        0,                  3, ingestVisualizerLevels, runVisualizerLevels,         "visualizerShowLevels"},
+  {'V', 4,   lengthFixed,        0,                  4, nullptr,                runViewportMove,             "viewportMove"},
+  {'w', 1,   lengthFixed,        0,                  1, nullptr,                runPWM,                      "writeAllPWM"},
+  {'x', 5,   lengthFixed,        commandPreemptible, 5, nullptr,                runCrossfade,                "crossfadePattern"},
+  {'y', 1,   lengthSampleFormat, 0,                  2, ingestVisualizerPCM,    runVisualizerPCM,            "visualizerShowPCM"},
+  {'Y', 0,   lengthFixed,        commandReports,     0, nullptr,                visualizerReport,            "visualizerReport"},
+  {'z', 7,   lengthFixed,        commandPreemptible, 6, ingestEffect,           runEffect,                   "effectPattern"},
+  {'Z', 0,   lengthFixed,        commandReports,     0, nullptr,                idleReport,                  "idleReport"},
+  {127, 0,   lengthFixed,        commandReports,     0, nullptr,                runVersion,                  "versionStatement"},
+};
+
+// The table entry of every opcode, built when compiling.
+constexpr CommandIndex commandLookup = commandIndex(commandTable);
+static_assert(commandsValid(commandTable), "invalid command table");
+
+void runCommandReport() {
+  commandReport(commandTable);
+}
+
+
 // setup and loop run on core 0 of the rp2040.
 // This core reads commands and sends them to core 1.
 void setup() {
@@ -277,15 +839,36 @@ void setup() {
   // Reset all of the LED Matrix controller registers
   matrixReset();
 
+  // Start each LED's dither cycle at a different phase.
+  ditherResetResidual();
+
+  // Start with a virtual frame the size of the matrix.
+  viewportResize(LEDWidth, LEDHeight);
+
+  // Set the startup scale here rather than as a command, so the FIFO holds
+  // exactly one command when core 1 starts.
+  writeAllScale(127);
+
   // Push startup animation
-  rp2040.fifo.push('s');
-  rp2040.fifo.push(127);
-  newCommand = true;
   rp2040.fifo.push('A');
   newCommand = true;
 }
 
 void loop() {
+  // Send the next frame rendered by core 1, or drop it if a new command is
+  // waiting.
+  pipelineTransmit(newCommand);
+
+  // While core 1 is idle, wait for events until serial arrives, then wake
+  // core 1.
+  if (idleActive) {
+    if (!Serial.available()) {
+      __wfe();
+      return;
+    }
+    idleWake();
+  }
+
   // If core 1 is still processing the last command, restart loop.
   if (newCommand == true) return;
 
@@ -294,100 +877,50 @@ void loop() {
 
   // If the data is not a real number, restart loop.
   if (readByte == -1) return;
-  
+
   // Convert the read byte to unsigned byte format.
   uint8_t codeByte = readByte;
+  idleTouch();
 
-  // Send the byte to core 1.
-  rp2040.fifo.push(codeByte);
+  // Read the command's payload, dropping the command if it does not all
+  // arrive in time. Unknown opcodes have none, and are ignored by core 1.
+  uint8_t entry = commandLookup.entry[codeByte];
+  if (entry != commandUnknown && !commandReadPayload(commandTable[entry])) {
+    return;
+  }
 
-  // Some commands need extra variables
-  int availableBytes;
-  // For certain commands, accept extra input.
-  int startTime = millis();
-  switch (codeByte) {
-    // Accept range and fps for diamond pattern.
-    case 'd':
-      for(int i = 0; i < 3; i++) {
-        rp2040.fifo.push(uint8_t(Serial.read()));
-      }
-      break;
-    // Accept fps for gear pattern.
-    case 'g':
-      rp2040.fifo.push(uint8_t(Serial.read()));
-      break;
-    // Accept full matrix of pwm for matrix set pwm.
-    case 'm':
-      for (int i = 0; i < LEDHeight; i++) {
-        for (int j = 0; j < LEDWidth; j++) {
-          inputMatrix[i][j] = Serial.read();
-        }
-      }
-      break;
-    // Accept full matrix of pwm for matrix set pwm blocking.
-    case 'M':
-      for (int i = 0; i < LEDHeight; i++) {
-        for (int j = 0; j < LEDWidth; j++) {
-          inputMatrix[i][j] = Serial.read();
-        }
-      }
-      break;
-    // Accept full matrix of scale for matrix set scale.
-    case 'n':
-      for (int i = 0; i < LEDHeight; i++) {
-        for (int j = 0; j < LEDWidth; j++) {
-          inputMatrix[i][j] = Serial.read();
-        }
-      }
-      break;
-    // Accept full matrix of scale for matrix set pwm blocking.
-    case 'N':
-      for (int i = 0; i < LEDHeight; i++) {
-        for (int j = 0; j < LEDWidth; j++) {
-          inputMatrix[i][j] = Serial.read();
-        }
-      }
-      break;
-    // Accept x, y, and pwm for setPixel.
-    case 'p':
-      for(int i = 0; i < 3; i++) {
-        rp2040.fifo.push(uint8_t(Serial.read()));
-      }
-      break;
-    // Accept x, y, and scale for setPixelScale.
-    case 'q':
-      for(int i = 0; i < 3; i++) {
-        rp2040.fifo.push(uint8_t(Serial.read()));
-      }
-      break;
-    // Accept fps for ringPattern.
-    case 'r':
-      rp2040.fifo.push(uint8_t(Serial.read()));
-      break;
-    // Accept byte for setting the matrix's scale.
-    case 's':
-      rp2040.fifo.push(uint8_t(Serial.read()));
-      break;
-    // Accept byte for setting the matrix's PWM.
-    case 'w':
-      rp2040.fifo.push(uint8_t(Serial.read()));
-      break;
+  // Send the byte to core 1, then the FIFO entries of its payload.
+  rp2040.fifo.push(codeByte);
+  if (entry != commandUnknown) {
+    commandIngest(commandTable[entry]);
   }
-  
-  // Inform core 1 that a new command was pushed.
+
+  // Inform core 1 that a new command was pushed, waking it if it is idle.
+  // Publish the command's buffers before the flag.
+  __sync_synchronize();
   newCommand = true;
+  __sev();
 }
 
 
 // setup1 and loop1 run on core 1 of the rp2040.
 // This core executes commands in an interruptable manner.
 void setup1() {
-  newCommand = false;
+  // Wait for the startup command, so core 1 never uses I2C while core 0 is
+  // still resetting the matrix.
+  while (!newCommand) {
+    tight_loop_contents();
+  }
 }
 
 void loop1() {
-  // If there is no new command, restart loop1.
-  if (newCommand == false) return;
+  // If there is no new command, idle if it is time to, then restart loop1.
+  if (newCommand == false) {
+    if (idleDue()) {
+      idleRun(newCommand);
+    }
+    return;
+  }
 
   // If there is a new command, set the indicator to false and run the command.
   newCommand = false;
@@ -395,116 +928,12 @@ void loop1() {
   // Get code of command
   uint8_t commandCode = rp2040.fifo.pop();
 
-  // Potentially needed variables
-  uint16_t range;
-  uint8_t fps;
   // Run command. Often can be interrupted.
-  switch(commandCode) {
-    // No op
-    case 0:
-      break;
-    // Run the startup animation until interrupted.
-    case 'a':
-      startupAnimation();
-      break;
-    // Run the startup animation once.
-    case 'A':
-      singleStartupAnimation();
-      writeAll(0);
-      break;
-    // Burn the current inputMatrix.
-    case 'b':
-      burnPattern();
-      break;
-    // Clear the intercore fifo queue.
-    case 'c':
-      rp2040.fifo.clear();
-      break;
-    // Run the diamond pattern with serial arguments.
-    case 'd':
-      if (rp2040.fifo.available()) {
-        fps = rp2040.fifo.pop();
-      }
-      diamondPattern(fps);
-      break;
-    // Send the rp2040 to the bootloader.
-    case 'e':
-      endFirmware();
-      break;
-    // Display a fire until a new command is run.
-    case 'f':
-      fireplacePattern();
-      break;
-    // Display the Framwork gear spinning at a given framerate.
-    case 'g':
-      if (rp2040.fifo.available()) {
-        fps = rp2040.fifo.pop();
-      }
-      rotateGear(fps);
-      break;
-    // Write the entire matrix PWM from the serial port.
-    case 'm':
-      serialWriteMatrix();
-      break;
-    // Write the entire matrix PWM from the serial port, then send a response
-    // for blocking.
-    case 'M':
-      serialWriteMatrixBlocking();
-      break;
-    // Write the entire matrix scale from the serial port.
-    case 'n':
-      serialWriteMatrixScale();
-      break;
-    // Write the entire matrix scale from the serial port, then send a response
-    // for blocking.
-    case 'N':
-      serialWriteMatrixScaleBlocking();
-      break;
-    // Set a given pixel's PWM using serial arguments.
-    case 'p':
-      if (rp2040.fifo.available() >= 3) {
-        setPixel(rp2040.fifo.pop(), rp2040.fifo.pop(), rp2040.fifo.pop());
-      } else {
-        Serial.println("ERROR: too few arguments for setPixel");
-      }
-      break;
-    // Set a given pixel's Scale using serial arguments.
-    case 'q':
-      if (rp2040.fifo.available() >= 3) {
-        setPixelScale(rp2040.fifo.pop(), rp2040.fifo.pop(), rp2040.fifo.pop());
-      } else {
-        Serial.println("ERROR: too few arguments for setPixelScale");
-      }
-      break;
-    // Display the ring with an fps from serial arguments.
-    case 'r':
-      if (rp2040.fifo.available()) {
-        fps = rp2040.fifo.pop();
-      }
-      ringPattern(fps);
-      break;
-    // Set the scale of every LED.
-    case 's':
-      if (rp2040.fifo.available()) {
-        writeAllScale(rp2040.fifo.pop());
-      } else {
-        Serial.println("ERROR: too few arguments for writeAllScale");
-      }
-      break;
-    // Run a test pattern on every LED and PWM.
-    case 't':
-      testAllPixel();
-      break;
-    // Set the PWM of every LED.
-    case 'w':
-      if (rp2040.fifo.available()) {
-        writeAll(rp2040.fifo.pop());
-      } else {
-        Serial.println("ERROR: too few arguments for writeAllPWM");
-      }
-      break;
-    // Print a known statement to confirm this firmware.
-    case 127:
-      Serial.print(versionStatement);
+  uint8_t entry = commandLookup.entry[commandCode];
+  if (entry != commandUnknown) {
+    commandRun(commandTable[entry]);
   }
+
+  // Start the idle timeout from the end of the command.
+  idleTouch();
 }
@@ -0,0 +1,157 @@
+/*
+  Written by sigroot (github.com/sigroot)
+
+  rp2040_idle.h - Power saving for the LEDMatrix input module while nothing
+  is displayed or the host has stopped sending commands.
+
+  While idle the matrix controller is in software shutdown and both cores
+  wait for events instead of polling. The controller keeps its PWM and scale
+  registers in shutdown, so waking only writes back the function registers
+  that idling changed.
+
+*/
+
+#define SIG_IDLE 1
+
+#if !(SIG_FIRMWARE)
+#include "rp2040_firmware.h"
+#endif
+
+//    *** Constants ***
+
+// Flags of the idle settings.
+//  0x01 - Idle once the displayed image is all black
+//  0x02 - Lower the PWM frequency while idle
+const uint8_t idleOnBlack = 0x01;
+const uint8_t idleLowFrequency = 0x02;
+const uint8_t idleFlagsDefault = idleOnBlack;
+
+// How long a black image must be displayed before idling, so a stream with
+// the odd black frame is not shut down between frames.
+const uint32_t idleBlackMillis = 100;
+
+// The PWM frequency setting while idle (900Hz).
+const uint8_t idlePWMRegister = 0b00001011;
+
+
+//    *** Global Variables ***
+
+// Settings from the 'I' command. A timeout of 0 never idles on time alone.
+uint32_t idleTimeoutMillis = 0;
+uint8_t idleFlags = idleFlagsDefault;
+
+// When core 0 last received a command or core 1 last finished one.
+volatile uint32_t idleLastActivity;
+
+// Set by core 1 while the cores are idle. Cleared by core 0 when serial
+// arrives.
+volatile bool idleActive;
+
+// When core 0 saw the serial that ended idling.
+volatile uint32_t idleWakeStart;
+
+// Statistics since startup. Read with the 'Z' command.
+uint32_t idleEntries;
+uint32_t idleMillis;
+uint32_t idleEnterMicros;
+uint32_t idleWakeMicros;
+uint32_t idleMaxWakeMicros;
+
+
+//    *** Functions ***
+
+// Note activity so the idle timeout starts again.
+void idleTouch() {
+  idleLastActivity = millis();
+}
+
+// Returns true if every LED shows PWM 0 once the displayed image has been
+// through the current transform, so an inverted black image is not black
+// and any image at brightness 0 is.
+bool idleDisplayBlack() {
+  for (uint8_t y = 0; y < LEDHeight; y++) {
+    for (uint8_t x = 0; x < LEDWidth; x++) {
+      uint8_t ledX = x;
+      uint8_t ledY = y;
+      uint8_t pwm = displayedMatrix[y][x];
+      pixelMap(ledX, ledY, pwm);
+      if (pwm) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Returns true if core 1 should idle now. Core 1 only asks between commands.
+bool idleDue() {
+  uint32_t quiet = millis() - idleLastActivity;
+  if (idleTimeoutMillis && quiet >= idleTimeoutMillis) {
+    return true;
+  }
+  return (idleFlags & idleOnBlack) && quiet >= idleBlackMillis && idleDisplayBlack();
+}
+
+// Shut the matrix down and wait for events until core 0 sees serial or
+// commandWaiting is set, then bring the matrix back from the cached
+// registers. Runs on core 1.
+void idleRun(volatile bool &commandWaiting) {
+  uint32_t startTime = micros();
+  uint8_t savedConfig = configRegisterValue;
+  uint8_t savedPWM = PWMRegisterValue;
+  setConfigurationRegister(savedConfig & ~configSSDBit);
+  if (idleFlags & idleLowFrequency) {
+    setPWMFrequencyRegister(idlePWMRegister);
+  }
+  idleEnterMicros = micros() - startTime;
+  idleEntries++;
+
+  uint32_t idleStart = millis();
+  idleActive = true;
+  while (idleActive && !commandWaiting) {
+    __wfe();
+  }
+  // A command that arrived while shutting down is measured from now.
+  if (idleActive) {
+    idleActive = false;
+    idleWakeStart = micros();
+  }
+
+  if (PWMRegisterValue != savedPWM) {
+    setPWMFrequencyRegister(savedPWM);
+  }
+  setConfigurationRegister(savedConfig);
+
+  idleWakeMicros = micros() - idleWakeStart;
+  idleMaxWakeMicros = max(idleMaxWakeMicros, idleWakeMicros);
+  idleMillis += millis() - idleStart;
+  idleTouch();
+}
+
+// End idling once serial has arrived. Runs on core 0.
+void idleWake() {
+  idleWakeStart = micros();
+  idleActive = false;
+  __sev();
+}
+
+// Print how often and how long the module has idled, and how long the last
+// shutdown and wake took.
+void idleReport() {
+  Serial.print("IDLE entries=");
+  Serial.print(idleEntries);
+  Serial.print(" idle_ms=");
+  Serial.print(idleMillis);
+  Serial.print(" uptime_ms=");
+  Serial.print(millis());
+  Serial.print(" enter_us=");
+  Serial.print(idleEnterMicros);
+  Serial.print(" wake_us=");
+  Serial.print(idleWakeMicros);
+  Serial.print(" max_wake_us=");
+  Serial.print(idleMaxWakeMicros);
+  Serial.print(" timeout_s=");
+  Serial.print(idleTimeoutMillis / 1000);
+  Serial.print(" flags=");
+  Serial.println(idleFlags);
+}
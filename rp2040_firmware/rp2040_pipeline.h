@@ -0,0 +1,146 @@
+/*
+  Written by sigroot (github.com/sigroot)
+
+  rp2040_pipeline.h - Frame queue between the render stage on core 1 and the
+  I2C transmit stage on core 0 of the LEDMatrix input module.
+
+  Core 1 renders a frame into the queue while core 0 sends the previous
+  frame over I2C, so procedural patterns are limited by the slower of the
+  two stages instead of their sum. While frames are queued only core 0
+  uses I2C.
+
+*/
+
+#define SIG_PIPELINE 1
+
+#if !(SIG_FIRMWARE)
+#include "rp2040_firmware.h"
+#endif
+
+//    *** Constants ***
+
+// The number of frames that can wait between the render and transmit stages.
+const uint8_t pipelineDepth = 2;
+
+
+//    *** Global Variables ***
+
+// Frames waiting to be sent, and whether each is sent with gamma correction.
+uint8_t pipelineFrames[2][34][9];
+bool pipelineGamma[2];
+
+// The count of frames ever submitted by core 1 and ever taken by core 0.
+// Only core 1 writes the head and only core 0 writes the tail.
+volatile uint8_t pipelineHead;
+volatile uint8_t pipelineTail;
+
+// Statistics of the current pipeline run. Read with the 'P' command.
+uint32_t pipelineStartMillis;
+uint32_t pipelineEndMillis;
+uint32_t pipelineRendered;
+uint32_t pipelineTransmitted;
+uint32_t pipelineDropped;
+uint32_t pipelineRenderMicros;
+uint32_t pipelineWaitMicros;
+uint32_t pipelineTransmitMicros;
+
+// When core 1 started rendering the current frame.
+uint32_t pipelineRenderStart;
+
+
+//    *** Render stage (core 1) ***
+
+// Reset the statistics read with the 'P' command for a new pipeline run.
+void pipelineBegin() {
+  pipelineStartMillis = millis();
+  pipelineRendered = 0;
+  pipelineTransmitted = 0;
+  pipelineDropped = 0;
+  pipelineRenderMicros = 0;
+  pipelineWaitMicros = 0;
+  pipelineTransmitMicros = 0;
+}
+
+// Returns true if every frame of the queue is waiting to be sent.
+bool pipelineFull() {
+  return uint8_t(pipelineHead - pipelineTail) >= pipelineDepth;
+}
+
+// Returns true once core 0 has sent or dropped every queued frame.
+bool pipelineEmpty() {
+  return pipelineHead == pipelineTail;
+}
+
+// Returns the free frame to render into. Only call when the queue is not
+// full.
+uint8_t (*pipelineBack())[LEDWidth] {
+  pipelineRenderStart = micros();
+  return pipelineFrames[pipelineHead % pipelineDepth];
+}
+
+// Queue the frame returned by pipelineBack() to be sent by core 0.
+void pipelineSubmit(bool useGamma = false) {
+  pipelineGamma[pipelineHead % pipelineDepth] = useGamma;
+  pipelineRenderMicros += micros() - pipelineRenderStart;
+  pipelineRendered++;
+
+  // Publish the frame before the new head.
+  __sync_synchronize();
+  pipelineHead = pipelineHead + 1;
+}
+
+
+//    *** Transmit stage (core 0) ***
+
+// Send the oldest queued frame, if any, over I2C. A cancelled frame is
+// dropped instead so a new command is not delayed by stale frames.
+void pipelineTransmit(bool cancelled) {
+  if (pipelineEmpty()) {
+    return;
+  }
+  __sync_synchronize();
+
+  uint8_t slot = pipelineTail % pipelineDepth;
+  if (cancelled) {
+    pipelineDropped++;
+  } else {
+    uint32_t startTime = micros();
+    writeMatrix(pipelineFrames[slot], pipelineGamma[slot]);
+    pipelineTransmitMicros += micros() - startTime;
+    pipelineTransmitted++;
+  }
+
+  // Release the frame only once I2C is finished with it.
+  __sync_synchronize();
+  pipelineTail = pipelineTail + 1;
+}
+
+
+//    *** Statistics ***
+
+// Print the throughput of the last pipeline run, and the throughput the same
+// frames would have had rendering and transmitting one after the other.
+void pipelineReport() {
+  uint32_t elapsed = max(pipelineEndMillis - pipelineStartMillis, uint32_t(1));
+  uint32_t rendered = max(pipelineRendered, uint32_t(1));
+  uint32_t transmitted = max(pipelineTransmitted, uint32_t(1));
+  uint32_t renderMicros = pipelineRenderMicros / rendered;
+  uint32_t transmitMicros = pipelineTransmitMicros / transmitted;
+
+  Serial.print("PIPELINE fps=");
+  Serial.print(pipelineTransmitted * 1000 / elapsed);
+  Serial.print(" serial_fps=");
+  Serial.print(1000000 / max(renderMicros + transmitMicros, uint32_t(1)));
+  Serial.print(" rendered=");
+  Serial.print(pipelineRendered);
+  Serial.print(" transmitted=");
+  Serial.print(pipelineTransmitted);
+  Serial.print(" dropped=");
+  Serial.print(pipelineDropped);
+  Serial.print(" core1_render_us=");
+  Serial.print(renderMicros);
+  Serial.print(" core1_wait_us=");
+  Serial.print(pipelineWaitMicros / rendered);
+  Serial.print(" core0_transmit_us=");
+  Serial.println(transmitMicros);
+}
@@ -0,0 +1,116 @@
+/*
+  Written by sigroot (github.com/sigroot)
+
+  rp2040_transitions.h - Keyframe interpolation and crossfades between frames
+  generated on the LEDMatrix input module.
+
+*/
+
+#define SIG_TRANSITIONS 1
+
+#if !(SIG_FIRMWARE)
+#include "rp2040_firmware.h"
+#endif
+
+//    *** Constants ***
+
+// The number of frames that can be stored on the module for crossfades.
+const uint8_t frameSlotCount = 4;
+
+// The slot number that refers to the frame currently displayed.
+const uint8_t displayedSlot = 0xFF;
+
+// Easing curves of a transition.
+//  0 - Linear
+//  1 - Ease in (starts slow)
+//  2 - Ease out (ends slow)
+//  3 - Ease in and out (starts and ends slow)
+const uint8_t easeLinear = 0;
+const uint8_t easeIn = 1;
+const uint8_t easeOut = 2;
+const uint8_t easeInOut = 3;
+
+
+//    *** Global Variables ***
+
+// Frames stored with the 'k' command.
+uint8_t frameSlots[4][34][9];
+
+// The first and last frames of the running transition.
+uint8_t transitionFrom[34][9];
+uint8_t transitionTo[34][9];
+
+
+//    *** Functions ***
+
+// Apply an easing curve to a transition's progress.
+// Progress and the returned weight are fixed point from 0 (start) to 65535
+// (end).
+uint16_t ease(uint16_t progress, uint8_t curve) {
+  uint32_t t = progress;
+  uint32_t u = 65535 - t;
+
+  switch (curve) {
+    case easeIn:
+      return (t*t) >> 16;
+    case easeOut:
+      return 65535 - ((u*u) >> 16);
+    case easeInOut:
+      // Smoothstep: t*t*(3 - 2*t)
+      return (uint64_t((t*t) >> 16) * (3*65536 - 2*t)) >> 16;
+    default:
+      return t;
+  }
+}
+
+// Blend two frames into output.
+// A weight of 0 is entirely the from frame, 65535 is almost entirely the to
+// frame.
+void blendFrames(uint8_t from[LEDHeight][LEDWidth], uint8_t to[LEDHeight][LEDWidth], uint16_t weight, uint8_t output[LEDHeight][LEDWidth]) {
+  for (int i = 0; i < LEDHeight; i++) {
+    for (int j = 0; j < LEDWidth; j++) {
+      int32_t difference = int16_t(to[i][j]) - int16_t(from[i][j]);
+      output[i][j] = from[i][j] + ((difference * int32_t(weight)) >> 16);
+    }
+  }
+}
+
+// Find a stored frame by slot number. The displayed slot is the frame
+// currently on the matrix. Returns nullptr for an invalid slot.
+uint8_t (*getFrameSlot(uint8_t slot))[LEDWidth] {
+  if (slot == displayedSlot) {
+    return displayedMatrix;
+  }
+  if (slot >= frameSlotCount) {
+    return nullptr;
+  }
+  return frameSlots[slot];
+}
+
+// Store a frame in a slot. Returns 1 if the slot is invalid.
+uint8_t storeFrameSlot(uint8_t slot, uint8_t frame[LEDHeight][LEDWidth]) {
+  if (slot >= frameSlotCount) {
+    return 1;
+  }
+  memcpy(frameSlots[slot], frame, sizeof(frameSlots[slot]));
+  return 0;
+}
+
+// Prepare a transition between two frames. The frames are copied so that
+// either may change while the transition runs.
+void transitionBegin(uint8_t from[LEDHeight][LEDWidth], uint8_t to[LEDHeight][LEDWidth]) {
+  memcpy(transitionFrom, from, sizeof(transitionFrom));
+  memcpy(transitionTo, to, sizeof(transitionTo));
+}
+
+// Compute the frame of the prepared transition at elapsed out of duration
+// milliseconds into output. Returns true once it is the last frame.
+bool transitionFrame(uint32_t elapsed, uint32_t duration, uint8_t curve, uint8_t output[LEDHeight][LEDWidth]) {
+  if (elapsed >= duration) {
+    memcpy(output, transitionTo, sizeof(transitionTo));
+    return true;
+  }
+
+  blendFrames(transitionFrom, transitionTo, ease(elapsed * 65535 / duration, curve), output);
+  return false;
+}
@@ -0,0 +1,120 @@
+/*
+  Written by sigroot (github.com/sigroot)
+
+  rp2040_viewport.h - A virtual frame larger than the LEDMatrix input module,
+  shown through a movable 9x34 viewport.
+
+  The host uploads a long image (such as a 9x256 status feed) once, then
+  scrolls by sending a new offset or a scroll speed instead of a new frame.
+  Pixels are read through the viewport while they are uploaded to the
+  matrix, so nothing is copied to scroll.
+
+*/
+
+#define SIG_VIEWPORT 1
+
+#if !(SIG_FIRMWARE)
+#include "rp2040_firmware.h"
+#endif
+
+//    *** Constants ***
+
+// The number of bytes of the virtual frame, enough for 9x455 or 120x34.
+const uint16_t viewportCapacity = 4096;
+
+
+//    *** Global Variables ***
+
+// The virtual frame in reading order, viewportWidth values to a row. Written
+// and resized by core 1 with the 'u' and 'U' commands, so neither can change
+// it while a scroll is reading it.
+uint8_t viewportFrame[4096];
+uint16_t viewportWidth = 9;
+uint16_t viewportHeight = 34;
+
+// Slices read from serial by core 0 for the 'u' command. Core 0 alternates
+// between them so that it can read the next slice while core 1 copies the
+// last into the virtual frame.
+uint8_t viewportSlices[2][4096];
+uint8_t viewportSliceWrite;
+
+// The virtual pixel shown at the top left of the matrix. The viewport wraps
+// at the edges of the virtual frame.
+uint16_t viewportX;
+uint16_t viewportY;
+
+// Where each column and row of the matrix is in the virtual frame for the
+// current offset, so uploading needs no division. Set by viewportMove.
+uint16_t viewportColumns[9];
+uint16_t viewportRows[34];
+
+// The upload routine for the current transform, and the transform flags it
+// was chosen for.
+typedef uint8_t (*ViewportUpload)(uint8_t firstPage);
+ViewportUpload viewportUpload;
+uint8_t viewportUploadFlags = 0xFF;
+
+
+//    *** Upload ***
+
+// Reads each pixel of the matrix through the viewport for uploadPixels, and
+// remembers it as displayed.
+struct ViewportSource {
+  uint8_t operator()(uint8_t x, uint8_t y) const {
+    uint8_t pwm = viewportFrame[viewportRows[y] + viewportColumns[x]];
+    displayedMatrix[y][x] = pwm;
+    return pwm;
+  }
+};
+
+template <uint8_t Flags>
+uint8_t uploadViewport(uint8_t firstPage) {
+  return uploadPixels<Flags>(ViewportSource(), firstPage);
+}
+
+template <uint8_t Flags>
+struct ViewportUploadInstance {
+  static ViewportUpload get() { return uploadViewport<Flags>; }
+};
+
+// Writes the pixels in the viewport to the matrix LEDs' PWM.
+uint8_t writeViewport() {
+  // Only look up the upload routine again when the transform has changed.
+  if (viewportUploadFlags != transformPWMFlags) {
+    viewportUpload = TransformLookup<ViewportUpload, ViewportUploadInstance>::find(transformPWMFlags);
+    viewportUploadFlags = transformPWMFlags;
+  }
+  return viewportUpload(PWMPage1);
+}
+
+
+//    *** Functions ***
+
+// Move the viewport so that virtual pixel x, y is at the top left of the
+// matrix. Offsets outside the virtual frame wrap around it.
+void viewportMove(int32_t x, int32_t y) {
+  x %= viewportWidth;
+  y %= viewportHeight;
+  viewportX = x < 0 ? x + viewportWidth : x;
+  viewportY = y < 0 ? y + viewportHeight : y;
+
+  for (int i = 0; i < LEDWidth; i++) {
+    viewportColumns[i] = (viewportX + i) % viewportWidth;
+  }
+  for (int i = 0; i < LEDHeight; i++) {
+    viewportRows[i] = ((viewportY + i) % viewportHeight) * viewportWidth;
+  }
+}
+
+// Change the size of the virtual frame, clearing it and moving the viewport
+// to the top left. Returns 1 if the size is empty or does not fit.
+uint8_t viewportResize(uint16_t width, uint16_t height) {
+  if (width == 0 || height == 0 || uint32_t(width) * height > viewportCapacity) {
+    return 1;
+  }
+  viewportWidth = width;
+  viewportHeight = height;
+  memset(viewportFrame, 0, sizeof(viewportFrame));
+  viewportMove(0, 0);
+  return 0;
+}
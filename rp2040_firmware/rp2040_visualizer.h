@@ -0,0 +1,292 @@
+/*
+  Written by sigroot (github.com/sigroot)
+
+  rp2040_visualizer.h - Audio spectrum bars drawn on the LEDMatrix input
+  module from either 9 band levels or blocks of PCM samples.
+
+  PCM blocks are transformed with a 64 point fixed point FFT, so the host
+  only needs to send a few bytes per frame instead of a full image. The FFT,
+  drawing and upload of a frame run one after another on core 1 while core 0
+  reads the next block; they are not pipelined, and 'Y' reports whether the
+  three fit in a 60 fps frame.
+
+*/
+
+#define SIG_VISUALIZER 1
+
+#if !(SIG_FIRMWARE)
+#include "rp2040_firmware.h"
+#endif
+
+//    *** Constants ***
+
+// The number of bands, one per column of the matrix.
+const uint8_t visualizerBands = 9;
+
+// The number of PCM samples in each block sent with the 'y' command.
+const uint8_t visualizerSamples = 64;
+
+// The FFT bins (of 32) where each band starts, lowest frequency first. Bands
+// get wider with frequency so that each covers a similar musical range.
+const uint8_t visualizerBandStart[10] = { 1, 2, 3, 4, 6, 8, 11, 15, 21, 32 };
+
+// sin(2*PI*i/64) in Q15 for i from 0 to 47. cos(x) is sin(x + 16).
+const int16_t visualizerSine[48] = {
+  0, 3212, 6393, 9512, 12539, 15446, 18204, 20787,
+  23170, 25329, 27245, 28898, 30273, 31356, 32137, 32609,
+  32767, 32609, 32137, 31356, 30273, 28898, 27245, 25329,
+  23170, 20787, 18204, 15446, 12539, 9512, 6393, 3212,
+  0, -3212, -6393, -9512, -12539, -15446, -18204, -20787,
+  -23170, -25329, -27245, -28898, -30273, -31356, -32137, -32609
+};
+
+// Hann window in Q15, applied to each block before the FFT so that a tone
+// between bins does not leak into every band.
+const int16_t visualizerWindow[64] = {
+  0, 81, 325, 728, 1286, 1995, 2847, 3833,
+  4944, 6169, 7495, 8909, 10398, 11946, 13539, 15159,
+  16792, 18421, 20029, 21601, 23122, 24575, 25947, 27224,
+  28393, 29443, 30363, 31145, 31779, 32260, 32584, 32747,
+  32747, 32584, 32260, 31779, 31145, 30363, 29443, 28393,
+  27224, 25947, 24575, 23122, 21601, 20029, 18421, 16792,
+  15159, 13539, 11946, 10398, 8909, 7495, 6169, 4944,
+  3833, 2847, 1995, 1286, 728, 325, 81, 0
+};
+
+// The log2 level (in 1/16 steps) of the quietest magnitude that lights a
+// bar. Levels above it are doubled so a full scale tone fills a column.
+const uint8_t visualizerFloor = 80;
+
+// Bar and peak heights are in 1/256ths of a row.
+// How far a bar falls each frame once its band gets quieter.
+const uint16_t visualizerBarFall = 192;
+// How many frames a peak stays before it starts to fall, and how far it
+// falls each frame after that.
+const uint8_t visualizerPeakHold = 20;
+const uint16_t visualizerPeakFall = 64;
+
+// The PWM of bars and of the peak above each bar.
+const uint8_t visualizerBarPWM = 0x60;
+const uint8_t visualizerPeakPWM = 0xFF;
+
+// The time of one frame at 60 fps, which the FFT, drawing and upload of a
+// frame should fit in.
+const uint32_t visualizerBudgetMicros = 16666;
+
+
+//    *** Global Variables ***
+
+// PCM blocks written by core 0, converted to signed Q15. Core 0 alternates
+// between the two so it can read a block while core 1 transforms the last.
+int16_t visualizerPCM[2][64];
+uint8_t visualizerPCMWrite;
+
+// The working buffers of the FFT.
+int16_t visualizerReal[64];
+int16_t visualizerImag[64];
+
+// The level of each band (0-255) of the current frame.
+uint8_t visualizerLevels[9];
+
+// The height of each bar and its peak, and how long the peak has been held.
+uint16_t visualizerBarHeight[9];
+uint16_t visualizerPeakHeight[9];
+uint8_t visualizerPeakAge[9];
+
+// The frame drawn from the bars.
+uint8_t visualizerFrame[34][9];
+
+// Statistics since the last report. Read with the 'Y' command.
+uint32_t visualizerFrameCount;
+uint32_t visualizerFFTMicros;
+uint32_t visualizerRenderMicros;
+uint32_t visualizerUploadMicros;
+uint32_t visualizerMaxMicros;
+
+
+//    *** Functions ***
+
+// Returns the number of bytes of each sample of a PCM format.
+// Format 16 is signed 16 bit big-endian, anything else is unsigned 8 bit.
+uint8_t visualizerSampleBytes(uint8_t format) {
+  return format == 16 ? 2 : 1;
+}
+
+// Converts a sample read from serial to signed Q15.
+int16_t visualizerSample(uint8_t format, uint16_t raw) {
+  if (format == 16) {
+    return int16_t(raw);
+  }
+  return int16_t((raw - 128) << 8);
+}
+
+// Returns log2 of a magnitude in 1/16 steps (0 for 0 and 1).
+uint8_t visualizerLog2(uint16_t magnitude) {
+  if (magnitude == 0) {
+    return 0;
+  }
+  uint8_t bits = 31 - __builtin_clz(magnitude);
+  uint8_t fraction = bits >= 4 ? (magnitude >> (bits - 4)) & 15 : (magnitude << (4 - bits)) & 15;
+  return bits*16 + fraction;
+}
+
+// Transform the windowed block in visualizerReal with an in place radix 2
+// FFT. Every stage halves its outputs so nothing overflows, which scales the
+// result by 1/64.
+void visualizerFFT() {
+  // Reorder the samples by bit reversed index.
+  for (uint8_t i = 1, j = 0; i < visualizerSamples; i++) {
+    uint8_t bit = visualizerSamples >> 1;
+    for (; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j ^= bit;
+    if (i < j) {
+      int16_t swap = visualizerReal[i];
+      visualizerReal[i] = visualizerReal[j];
+      visualizerReal[j] = swap;
+      swap = visualizerImag[i];
+      visualizerImag[i] = visualizerImag[j];
+      visualizerImag[j] = swap;
+    }
+  }
+
+  for (uint8_t length = 2; length <= visualizerSamples; length <<= 1) {
+    uint8_t half = length >> 1;
+    uint8_t step = visualizerSamples / length;
+    for (uint8_t start = 0; start < visualizerSamples; start += length) {
+      for (uint8_t k = 0; k < half; k++) {
+        // The twiddle factor e^(-2*PI*i*k/length).
+        int32_t twiddleReal = visualizerSine[k*step + 16];
+        int32_t twiddleImag = -visualizerSine[k*step];
+
+        uint8_t a = start + k;
+        uint8_t b = a + half;
+        int32_t productReal = (visualizerReal[b]*twiddleReal - visualizerImag[b]*twiddleImag) >> 15;
+        int32_t productImag = (visualizerReal[b]*twiddleImag + visualizerImag[b]*twiddleReal) >> 15;
+
+        visualizerReal[b] = (visualizerReal[a] - productReal) >> 1;
+        visualizerImag[b] = (visualizerImag[a] - productImag) >> 1;
+        visualizerReal[a] = (visualizerReal[a] + productReal) >> 1;
+        visualizerImag[a] = (visualizerImag[a] + productImag) >> 1;
+      }
+    }
+  }
+}
+
+// Find the level of each band from a block of PCM samples.
+void visualizerAnalyse(int16_t samples[visualizerSamples]) {
+  for (uint8_t i = 0; i < visualizerSamples; i++) {
+    visualizerReal[i] = (int32_t(samples[i]) * visualizerWindow[i]) >> 15;
+    visualizerImag[i] = 0;
+  }
+
+  visualizerFFT();
+
+  for (uint8_t band = 0; band < visualizerBands; band++) {
+    // The loudest bin of the band. Magnitudes are approximated as the larger
+    // component plus half the smaller.
+    uint16_t loudest = 0;
+    for (uint8_t bin = visualizerBandStart[band]; bin < visualizerBandStart[band + 1]; bin++) {
+      uint16_t real = abs(visualizerReal[bin]);
+      uint16_t imag = abs(visualizerImag[bin]);
+      uint16_t magnitude = real > imag ? real + imag/2 : imag + real/2;
+      if (magnitude > loudest) {
+        loudest = magnitude;
+      }
+    }
+
+    uint8_t level = visualizerLog2(loudest);
+    visualizerLevels[band] = level > visualizerFloor ? min((level - visualizerFloor)*2, 255) : 0;
+  }
+}
+
+// Move the bars and peaks towards the current band levels, then draw them
+// into visualizerFrame. Bars rise at once and fall slowly.
+void visualizerRender() {
+  for (uint8_t x = 0; x < visualizerBands; x++) {
+    uint16_t target = visualizerLevels[x] * LEDHeight;
+
+    uint16_t &bar = visualizerBarHeight[x];
+    bar = bar > target + visualizerBarFall ? bar - visualizerBarFall : target;
+
+    uint16_t &peak = visualizerPeakHeight[x];
+    if (bar >= peak) {
+      peak = bar;
+      visualizerPeakAge[x] = 0;
+    } else if (visualizerPeakAge[x] < visualizerPeakHold) {
+      visualizerPeakAge[x]++;
+    } else {
+      peak = peak > bar + visualizerPeakFall ? peak - visualizerPeakFall : bar;
+    }
+
+    // Draw from the bottom row up. The top row of a bar is partly lit.
+    uint8_t fullRows = bar >> 8;
+    uint8_t peakRow = min(peak >> 8, LEDHeight - 1);
+    for (uint8_t row = 0; row < LEDHeight; row++) {
+      uint8_t pwm = 0;
+      if (row < fullRows) {
+        pwm = visualizerBarPWM;
+      } else if (row == fullRows) {
+        pwm = ((bar & 0xFF) * visualizerBarPWM) >> 8;
+      }
+      if (peak > 0 && row == peakRow) {
+        pwm = visualizerPeakPWM;
+      }
+      visualizerFrame[(LEDHeight-1) - row][x] = pwm;
+    }
+  }
+}
+
+// Display a frame of bars from the current band levels, timing each step.
+void visualizerFrameFromLevels(uint32_t fftMicros) {
+  uint32_t renderStart = micros();
+  visualizerRender();
+  uint32_t uploadStart = micros();
+  writeMatrix(visualizerFrame);
+  uint32_t end = micros();
+
+  visualizerFrameCount++;
+  visualizerFFTMicros += fftMicros;
+  visualizerRenderMicros += uploadStart - renderStart;
+  visualizerUploadMicros += end - uploadStart;
+  visualizerMaxMicros = max(visualizerMaxMicros, fftMicros + end - renderStart);
+}
+
+// Display a frame of bars from 9 band levels sent by the host.
+void visualizerShowLevels(uint8_t levels[visualizerBands]) {
+  memcpy(visualizerLevels, levels, sizeof(visualizerLevels));
+  visualizerFrameFromLevels(0);
+}
+
+// Display a frame of bars from a block of PCM samples sent by the host.
+void visualizerShowPCM(int16_t samples[visualizerSamples]) {
+  uint32_t startTime = micros();
+  visualizerAnalyse(samples);
+  visualizerFrameFromLevels(micros() - startTime);
+}
+
+// Print the average cost of each step of a visualizer frame since the last
+// report, and the longest frame against the 60 fps frame time.
+void visualizerReport() {
+  uint32_t frames = max(visualizerFrameCount, uint32_t(1));
+
+  Serial.print("VISUALIZER frames=");
+  Serial.print(visualizerFrameCount);
+  Serial.print(" fft_us=");
+  Serial.print(visualizerFFTMicros / frames);
+  Serial.print(" render_us=");
+  Serial.print(visualizerRenderMicros / frames);
+  Serial.print(" upload_us=");
+  Serial.print(visualizerUploadMicros / frames);
+  Serial.print(" max_frame_us=");
+  Serial.print(visualizerMaxMicros);
+  Serial.print(" budget_us=");
+  Serial.println(visualizerBudgetMicros);
+
+  visualizerFrameCount = 0;
+  visualizerFFTMicros = 0;
+  visualizerRenderMicros = 0;
+  visualizerUploadMicros = 0;
+  visualizerMaxMicros = 0;
+}